@@ -0,0 +1,42 @@
+// batch.cpp - CID of many independent symbol buffers in one call
+
+#include <chrono>
+#include <climits>
+#include <stdexcept>
+
+#include "batch.h"
+#include "parallel.h"
+#include "topology.h"
+#include "trace.h"
+
+std::vector<BatchResult> compute_cid_batch(const unsigned char* data,
+                                           const std::vector<long long>& offsets,
+                                           int n_threads,
+                                           const CidOptions& options) {
+    if (offsets.empty()) {
+        throw std::runtime_error("Batch needs row offsets");
+    }
+    size_t num_rows = offsets.size() - 1;
+    for (size_t r = 0; r < num_rows; r++) {
+        long long length = offsets[r + 1] - offsets[r];
+        if (length <= 0 || length > INT_MAX) {
+            throw std::runtime_error("Batch row " + std::to_string(r) + " is empty or too long");
+        }
+    }
+
+    std::vector<BatchResult> results(num_rows);
+    int n_workers = resolve_threads(n_threads, num_rows);
+    // Workspaces start empty and are first filled by their worker, so on
+    // NUMA machines they end up on the worker's node
+    std::vector<Workspace> workspaces(n_workers);
+    numa_parallel_for(num_rows, n_workers, [&](size_t r, int w) {
+        auto start = std::chrono::steady_clock::now();
+        TraceSpan span("cid", r, offsets[r + 1] - offsets[r]);
+        results[r].stats = compute_cid(data + offsets[r],
+                                       static_cast<int>(offsets[r + 1] - offsets[r]),
+                                       workspaces[w], options);
+        results[r].seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    });
+    return results;
+}
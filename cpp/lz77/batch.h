@@ -0,0 +1,25 @@
+// batch.h - CID of many independent symbol buffers in one call
+// The rows are slices of one contiguous buffer, read in place, and are
+// spread over worker threads that each keep their own Workspace.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+
+#include "lz77.h"
+
+struct BatchResult {
+    CompressionStats stats;
+    double seconds;   // wall time of this row on its worker
+};
+
+// Row r is data[offsets[r] .. offsets[r + 1]); offsets has one entry more
+// than there are rows. Results are in row order whatever the thread count
+// (n_threads, 0 = all cores).
+std::vector<BatchResult> compute_cid_batch(const unsigned char* data,
+                                           const std::vector<long long>& offsets,
+                                           int n_threads,
+                                           const CidOptions& options = CidOptions());
+
+#endif // BATCH_H
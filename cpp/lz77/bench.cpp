@@ -0,0 +1,392 @@
+// bench.cpp - Throughput and scaling benchmarks of the CID pipeline stages
+// Times file read, binning, suffix array, LCP, factorization and
+// end-to-end CID on the bundled example datasets and on synthetic strings,
+// and prints one tab-separated line per dataset and stage:
+//   dataset  symbols  stage  reps  median_s  mad_s  bytes_per_s
+// With --scaling it instead sweeps the input size over several regimes,
+// fits the exponent k of time ~ n^k per stage and fails (exit status 1)
+// if any k exceeds the bound; after the timing lines it prints
+//   regime  stage  exponent  bound  ok|FAIL
+// With --compare-pages it times the stages with standard and with
+// transparent huge pages and ends with
+//   dataset  stage  standard_s  huge_s  speedup
+// Synthetic inputs use fixed seeds so runs are comparable across commits.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "binning.h"
+#include "hilbert.h"
+#include "hugepage.h"
+#include "lz77.h"
+#include "shuffle.h"
+
+namespace {
+
+struct BenchOptions {
+    int reps = 5;
+    std::string examples = "../../examples";
+    int snapshots = 1;       // polymer snapshots to include
+    int min_bins = 16;
+    int max_bins = 128;
+    uint64_t seed = 12345;
+    // Scaling sweep
+    long long max_size = 100000000;   // about 32 bytes of workspace per symbol
+    long long fit_from = 100000;      // smaller sizes are dominated by overheads
+    double bound = 1.5;      // cache misses push linear stages to ~1.3
+};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// Time fn reps times (after one warm-up run unless warm_up is false),
+// print its line and return the median
+double bench(const std::string& dataset, long long symbols, const std::string& stage,
+             long long bytes, const BenchOptions& options, const std::function<void()>& fn,
+             bool warm_up = true) {
+    if (warm_up) {
+        fn();
+    }
+    std::vector<double> times;
+    for (int r = 0; r < options.reps; r++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    double med = median(times);
+    std::vector<double> deviations;
+    for (double t : times) {
+        deviations.push_back(std::fabs(t - med));
+    }
+    std::cout << dataset << "\t" << symbols << "\t" << stage << "\t" << options.reps << "\t"
+              << med << "\t" << median(deviations) << "\t"
+              << (med > 0 ? bytes / med : 0.0) << std::endl;
+    return med;
+}
+
+const char* STAGES[] = {"sa", "lcp", "factorize", "cid"};
+const int NUM_STAGES = 4;
+
+// Suffix structure stages and end-to-end CID of one symbol buffer; returns
+// the median time of each stage in STAGES order
+std::vector<double> bench_buffer(const std::string& dataset, const std::string& text,
+                                 const BenchOptions& options, bool warm_up = true) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    int n = text.length();
+    Workspace ws;
+    std::vector<double> medians;
+    medians.push_back(bench(dataset, n, STAGES[0], n, options,
+                            [&]() { build_suffix_array(data, n, ws); }, warm_up));
+    medians.push_back(bench(dataset, n, STAGES[1], n, options,
+                            [&]() { build_lcp(data, n, ws); }, warm_up));
+    medians.push_back(bench(dataset, n, STAGES[2], n, options, [&]() {
+        build_psv_nsv(data, n, ws);
+        lz77_factorize(n, ws);
+    }, warm_up));
+    medians.push_back(bench(dataset, n, STAGES[3], n, options,
+                            [&]() { compute_cid(data, n, ws); }, warm_up));
+    return medians;
+}
+
+// Read, bin and factorize one particle file at every grid size; binning is
+// timed from the particles in file order (bin) and from the particles
+// sorted once along the curve (bin_sorted, after the hilbert_sort line)
+void bench_particles(const std::string& name, const std::string& path, bool lammps,
+                     double box_size, const BenchOptions& options) {
+    struct stat info;
+    long long file_bytes = stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+    std::vector<Particle> particles;
+    bench(name, 0, "read", file_bytes, options, [&]() {
+        particles = lammps ? read_lammps_data(path, &box_size) : read_xyz(path);
+    });
+
+    int level = 1;
+    while ((1 << level) < options.max_bins) {
+        level++;
+    }
+    SortedParticles sorted;
+    bench(name, 0, "hilbert_sort", particles.size() * sizeof(Particle), options,
+          [&]() { sorted = hilbert_sort(particles, box_size, level); });
+
+    for (int nbins = options.min_bins; nbins <= options.max_bins; nbins *= 2) {
+        std::string dataset = name + "@" + std::to_string(nbins);
+        std::vector<int> order = hilbert_order(nbins);
+        std::string binned;
+        bench(dataset, order.size(), "bin", particles.size() * sizeof(Particle), options,
+              [&]() { binned = bin_particles(particles, nbins, box_size, order); });
+        bench(dataset, order.size(), "bin_sorted", sorted.size() * sizeof(uint64_t), options,
+              [&]() { binned = bin_sorted(sorted.keys.data(), sorted.size(), level, nbins); });
+        bench_buffer(dataset, binned, options);
+    }
+}
+
+std::vector<std::string> list_files(const std::string& dir, const std::string& suffix) {
+    std::vector<std::string> files;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name.size() > suffix.size() &&
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                files.push_back(name);
+            }
+        }
+        closedir(d);
+    }
+    // Natural order, so snapshot_2 comes before snapshot_10
+    std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    return files;
+}
+
+std::string synthetic(const std::string& kind, int length, uint64_t seed) {
+    std::string text(length, '0');
+    if (kind == "random") {
+        Rng rng(seed);
+        for (auto& c : text) {
+            c = static_cast<char>('0' + rng.below(4));
+        }
+    } else if (kind == "low-entropy") {
+        // Sparse occupancy: one cell in a hundred holds a particle
+        Rng rng(seed);
+        for (auto& c : text) {
+            c = rng.below(100) == 0 ? '1' : '0';
+        }
+    } else if (kind == "periodic") {
+        const std::string unit = "0120010";
+        for (int i = 0; i < length; i++) {
+            text[i] = unit[i % unit.size()];
+        }
+    }
+    return text;
+}
+
+// Real binned density at any length: binned polymer snapshots (64^3 cells
+// each) one after another, cycling through them if needed; empty if the
+// examples are missing
+std::string binned_density(long long length, const BenchOptions& options) {
+    std::string polymer_dir = options.examples + "/homopolymer_melt";
+    std::vector<std::string> snapshots = list_files(polymer_dir, ".xyz");
+    std::string text;
+    if (snapshots.empty()) {
+        return text;
+    }
+    std::vector<int> order = hilbert_order(64);
+    for (size_t k = 0; static_cast<long long>(text.size()) < length; k++) {
+        const std::string& name = snapshots[k % snapshots.size()];
+        text += bin_particles(read_xyz(polymer_dir + "/" + name), 64, 75.0, order);
+    }
+    text.resize(length);
+    return text;
+}
+
+// Least-squares slope of log(time) against log(size)
+double fit_exponent(const std::vector<long long>& sizes, const std::vector<double>& times) {
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = sizes.size();
+    for (int k = 0; k < n; k++) {
+        double x = std::log(static_cast<double>(sizes[k]));
+        double y = std::log(std::max(times[k], 1e-9));
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+// Sizes 10^3, 3 * 10^3, 10^4, ... up to max_size in every regime; returns
+// false if a fitted exponent exceeds the bound
+bool run_scaling(const BenchOptions& options) {
+    std::vector<long long> sizes;
+    for (long long decade = 1000; decade <= options.max_size; decade *= 10) {
+        sizes.push_back(decade);
+        if (3 * decade <= options.max_size) {
+            sizes.push_back(3 * decade);
+        }
+    }
+
+    std::vector<std::string> fits;
+    bool ok = true;
+    for (const char* regime : {"random", "low-entropy", "periodic", "density"}) {
+        std::vector<long long> fit_sizes;
+        std::vector<std::vector<double>> fit_times(NUM_STAGES);
+        for (long long size : sizes) {
+            std::string text = std::string(regime) == "density"
+                ? binned_density(size, options) : synthetic(regime, size, options.seed);
+            if (text.empty()) {
+                break;
+            }
+            // Warm-up only where a run is cheap
+            std::vector<double> medians = bench_buffer(regime, text, options, size < 1000000);
+            if (size >= options.fit_from) {
+                fit_sizes.push_back(size);
+                for (int s = 0; s < NUM_STAGES; s++) {
+                    fit_times[s].push_back(medians[s]);
+                }
+            }
+        }
+        if (fit_sizes.size() < 2) {
+            continue;
+        }
+        for (int s = 0; s < NUM_STAGES; s++) {
+            double exponent = fit_exponent(fit_sizes, fit_times[s]);
+            bool stage_ok = exponent <= options.bound;
+            ok = ok && stage_ok;
+            fits.push_back(std::string(regime) + "\t" + STAGES[s] + "\t" +
+                           std::to_string(exponent) + "\t" + std::to_string(options.bound) +
+                           "\t" + (stage_ok ? "ok" : "FAIL"));
+        }
+    }
+
+    std::cout << "\nregime\tstage\texponent\tbound\tresult\n";
+    for (const auto& line : fits) {
+        std::cout << line << "\n";
+    }
+    return ok;
+}
+
+// Suffix structure stages of random and binned density inputs at every
+// grid size, first on standard pages and then on transparent huge pages
+void run_page_comparison(const BenchOptions& options) {
+    std::vector<std::string> summary;
+    for (const char* kind : {"random", "density"}) {
+        for (int side = options.min_bins; side <= options.max_bins; side *= 2) {
+            long long length = static_cast<long long>(side) * side * side;
+            std::string text = std::string(kind) == "density"
+                ? binned_density(length, options) : synthetic(kind, length, options.seed);
+            if (text.empty()) {
+                continue;
+            }
+            std::string dataset = std::string(kind) + "@" + std::to_string(side);
+            set_huge_pages(HUGE_PAGES_NONE);
+            std::vector<double> standard = bench_buffer(dataset + "/4k", text, options);
+            set_huge_pages(HUGE_PAGES_THP);
+            std::vector<double> huge = bench_buffer(dataset + "/thp", text, options);
+            for (int s = 0; s < NUM_STAGES; s++) {
+                summary.push_back(dataset + "\t" + STAGES[s] + "\t" +
+                                  std::to_string(standard[s]) + "\t" + std::to_string(huge[s]) +
+                                  "\t" + std::to_string(huge[s] > 0 ? standard[s] / huge[s] : 0.0));
+            }
+        }
+    }
+    set_huge_pages(HUGE_PAGES_SYSTEM);
+
+    std::cout << "\ndataset\tstage\tstandard_s\thuge_s\tspeedup\n";
+    for (const auto& line : summary) {
+        std::cout << line << "\n";
+    }
+}
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]\n\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --reps N        Timed repetitions per stage (default 5)\n";
+    std::cerr << "  --examples DIR  Example datasets (default ../../examples)\n";
+    std::cerr << "  --snapshots K   Polymer snapshots to include (default 1)\n";
+    std::cerr << "  --min-bins B    Smallest grid side (default 16)\n";
+    std::cerr << "  --max-bins B    Largest grid side (default 128)\n";
+    std::cerr << "  --seed S        Seed of the random strings (default 12345)\n";
+    std::cerr << "  --scaling       Sweep input sizes and fit time ~ n^k per stage\n";
+    std::cerr << "  --max-size N    Largest scaling input (default 1e8, ~32 bytes/symbol)\n";
+    std::cerr << "  --fit-from N    Smallest size used in the fit (default 1e5)\n";
+    std::cerr << "  --bound K       Fail if a fitted exponent exceeds K (default 1.5)\n";
+    std::cerr << "  --huge-pages M  Page size of the engine buffers: system (default),\n";
+    std::cerr << "                  none, thp or explicit\n";
+    std::cerr << "  --compare-pages Time standard against huge pages and report the speedup\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    bool scaling = false;
+    bool compare_pages = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc) {
+            options.reps = std::stoi(argv[++i]);
+        } else if (arg == "--examples" && i + 1 < argc) {
+            options.examples = argv[++i];
+        } else if (arg == "--snapshots" && i + 1 < argc) {
+            options.snapshots = std::stoi(argv[++i]);
+        } else if (arg == "--min-bins" && i + 1 < argc) {
+            options.min_bins = std::stoi(argv[++i]);
+        } else if (arg == "--max-bins" && i + 1 < argc) {
+            options.max_bins = std::stoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::stoull(argv[++i]);
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else if (arg == "--max-size" && i + 1 < argc) {
+            options.max_size = static_cast<long long>(std::stod(argv[++i]));
+        } else if (arg == "--fit-from" && i + 1 < argc) {
+            options.fit_from = static_cast<long long>(std::stod(argv[++i]));
+        } else if (arg == "--bound" && i + 1 < argc) {
+            options.bound = std::stod(argv[++i]);
+        } else if (arg == "--huge-pages" && i + 1 < argc) {
+            try {
+                set_huge_pages(parse_huge_pages(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--compare-pages") {
+            compare_pages = true;
+        } else {
+            print_usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (options.reps < 1) {
+        std::cerr << "Error: --reps must be at least 1\n";
+        return 1;
+    }
+
+    try {
+        std::cout << "dataset\tsymbols\tstage\treps\tmedian_s\tmad_s\tbytes_per_s\n";
+        if (scaling) {
+            return run_scaling(options) ? 0 : 1;
+        }
+        if (compare_pages) {
+            run_page_comparison(options);
+            return 0;
+        }
+
+        for (const char* kind : {"random", "periodic", "constant"}) {
+            for (int side = options.min_bins; side <= options.max_bins; side *= 2) {
+                std::string text = synthetic(kind, side * side * side, options.seed);
+                bench_buffer(std::string(kind) + "@" + std::to_string(side), text, options);
+            }
+        }
+
+        std::string polymer_dir = options.examples + "/homopolymer_melt";
+        std::vector<std::string> snapshots = list_files(polymer_dir, ".xyz");
+        snapshots.resize(std::min<size_t>(snapshots.size(), options.snapshots));
+        for (const auto& name : snapshots) {
+            bench_particles("polymer/" + name, polymer_dir + "/" + name, false, 75.0, options);
+        }
+
+        std::string zif_dir = options.examples + "/zif-8";
+        for (const auto& name : list_files(zif_dir, ".data")) {
+            bench_particles("zif8/" + name, zif_dir + "/" + name, true, 0.0, options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
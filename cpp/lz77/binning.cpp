@@ -0,0 +1,231 @@
+// binning.cpp - Native particle readers and Hilbert-ordered 3D binning
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "binning.h"
+#include "dispatch.h"
+
+std::vector<Particle> read_xyz(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    std::vector<Particle> particles;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        double type;
+        Particle p;
+        if (!(fields >> type >> p.x >> p.y >> p.z)) {
+            throw std::runtime_error("Bad line in " + filename + ": " + line);
+        }
+        p.type = static_cast<int>(type);
+        particles.push_back(p);
+    }
+    return particles;
+}
+
+std::vector<Particle> read_lammps_data(const std::string& filename, double* box_size) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    std::vector<Particle> particles;
+    std::string line;
+    bool in_atoms = false;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        if (!in_atoms) {
+            double lo, hi;
+            if (line.find("xlo xhi") != std::string::npos && (fields >> lo >> hi) && box_size) {
+                *box_size = hi - lo;
+            }
+            if (line.compare(0, 5, "Atoms") == 0) {
+                in_atoms = true;
+                std::getline(file, line);  // blank line after the header
+            }
+            continue;
+        }
+        // The section ends at the first blank line
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            break;
+        }
+        long long id, mol;
+        double charge;
+        Particle p;
+        if (!(fields >> id >> mol >> p.type >> charge >> p.x >> p.y >> p.z)) {
+            throw std::runtime_error("Bad atom line in " + filename + ": " + line);
+        }
+        particles.push_back(p);
+    }
+    if (!in_atoms) {
+        throw std::runtime_error("No Atoms section in " + filename);
+    }
+    return particles;
+}
+
+// Skilling's transform from a Hilbert distance to 3D coordinates of p bits,
+// step for step as the hilbertcurve package
+static void point_from_distance(long long distance, int p, int x[3]) {
+    // Transpose: bit k of the distance (from the top) goes to axis k % 3
+    for (int i = 0; i < 3; i++) {
+        x[i] = 0;
+    }
+    for (int bit = 0; bit < 3 * p; bit++) {
+        int axis = bit % 3;
+        x[axis] = (x[axis] << 1) | ((distance >> (3 * p - 1 - bit)) & 1);
+    }
+    // Gray decode
+    int t = x[2] >> 1;
+    for (int i = 2; i > 0; i--) {
+        x[i] ^= x[i - 1];
+    }
+    x[0] ^= t;
+    // Undo excess work
+    for (int q = 2; q != (2 << (p - 1)); q <<= 1) {
+        int mask = q - 1;
+        for (int i = 2; i >= 0; i--) {
+            if (x[i] & q) {
+                x[0] ^= mask;
+            } else {
+                t = (x[0] ^ x[i]) & mask;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+}
+
+std::vector<int> hilbert_order(int nbins) {
+    if (nbins < 2 || (nbins & (nbins - 1)) != 0) {
+        throw std::runtime_error("Number of bins must be a power of two");
+    }
+    int p = 0;
+    while ((1 << p) < nbins) {
+        p++;
+    }
+    long long cells = static_cast<long long>(nbins) * nbins * nbins;
+    std::vector<int> order(cells);
+    int x[3];
+    for (long long d = 0; d < cells; d++) {
+        point_from_distance(d, p, x);
+        order[d] = (x[0] * nbins + x[1]) * nbins + x[2];
+    }
+    return order;
+}
+
+// Bin of v among the edges of np.linspace(0, box_size, nbins + 1), as
+// np.histogramdd assigns it (right edge inclusive); -1 if outside
+static int bin_of(double v, const std::vector<double>& edges) {
+    int bin = static_cast<int>(std::upper_bound(edges.begin(), edges.end(), v) - edges.begin());
+    if (v == edges.back()) {
+        bin--;
+    }
+    return bin >= 1 && bin < static_cast<int>(edges.size()) ? bin - 1 : -1;
+}
+
+HOT_KERNEL uint64_t hilbert_key(uint32_t cx, uint32_t cy, uint32_t cz, int level) {
+    // Skilling's axes-to-transpose, the inverse of point_from_distance
+    uint32_t x[3] = {cx, cy, cz};
+    uint32_t top = 1u << (level - 1);
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        uint32_t mask = q - 1;
+        for (int i = 0; i < 3; i++) {
+            if (x[i] & q) {
+                x[0] ^= mask;
+            } else {
+                uint32_t t = (x[0] ^ x[i]) & mask;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+    // Gray encode
+    for (int i = 1; i < 3; i++) {
+        x[i] ^= x[i - 1];
+    }
+    uint32_t t = 0;
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        if (x[2] & q) {
+            t ^= q - 1;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        x[i] ^= t;
+    }
+    // Interleave: bit b of every axis, from the top, axis 0 first
+    uint64_t key = 0;
+    for (int b = level - 1; b >= 0; b--) {
+        for (int i = 0; i < 3; i++) {
+            key = (key << 1) | ((x[i] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+int grid_cell(double v, int cells, double box_size) {
+    // Same edges as bin_particles (k * step, the last one box_size), so
+    // the cells of a coarser power-of-two grid are unions of these
+    if (!(v >= 0) || v > box_size) {
+        return -1;
+    }
+    if (v == box_size) {
+        return cells - 1;
+    }
+    double step = box_size / cells;
+    auto edge = [&](int k) { return k == cells ? box_size : k * step; };
+    int cell = std::min(static_cast<int>(v / step), cells - 1);
+    while (cell > 0 && edge(cell) > v) {
+        cell--;
+    }
+    while (cell + 1 < cells && edge(cell + 1) <= v) {
+        cell++;
+    }
+    return cell;
+}
+
+void append_cell(std::string& binned, int count, bool one_symbol_per_cell) {
+    if (one_symbol_per_cell) {
+        if (count > 255 - '0') {
+            throw std::runtime_error("Cell count too large for one symbol");
+        }
+        binned.push_back(static_cast<char>('0' + count));
+    } else {
+        binned += std::to_string(count);
+    }
+}
+
+HOT_KERNEL std::string bin_particles(const std::vector<Particle>& particles, int nbins,
+                                     double box_size, const std::vector<int>& order,
+                                     bool one_symbol_per_cell) {
+    std::vector<double> edges(nbins + 1);
+    double step = box_size / nbins;
+    for (int k = 0; k < nbins; k++) {
+        edges[k] = k * step;
+    }
+    edges[nbins] = box_size;
+
+    std::vector<int> counts(static_cast<size_t>(nbins) * nbins * nbins, 0);
+    for (const auto& particle : particles) {
+        int bx = bin_of(particle.x, edges);
+        int by = bin_of(particle.y, edges);
+        int bz = bin_of(particle.z, edges);
+        if (bx >= 0 && by >= 0 && bz >= 0) {
+            counts[(static_cast<size_t>(bx) * nbins + by) * nbins + bz]++;
+        }
+    }
+
+    std::string binned;
+    binned.reserve(order.size());
+    for (int cell : order) {
+        append_cell(binned, counts[cell], one_symbol_per_cell);
+    }
+    return binned;
+}
@@ -0,0 +1,50 @@
+// binning.h - Native particle readers and Hilbert-ordered 3D binning
+// Mirrors src/kappa (read_lammps_data, load_xyz_snapshot, bin_particles_3d)
+// so C++ tools can start from the example datasets: the same histogram
+// edges as np.histogramdd over [0, box_size], the same cell order as the
+// hilbertcurve package (Skilling's transform) and the same encoding.
+
+#ifndef BINNING_H
+#define BINNING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Particle {
+    int type;
+    double x, y, z;
+};
+
+// "type x y z" lines; lines starting with '#' are skipped
+std::vector<Particle> read_xyz(const std::string& filename);
+
+// Atoms section of a LAMMPS data file (atom_id mol_id type x y z ...);
+// box_size receives xhi - xlo if given
+std::vector<Particle> read_lammps_data(const std::string& filename,
+                                       double* box_size = nullptr);
+
+// Cell indices (x * nbins^2 + y * nbins + z) in Hilbert order; nbins must
+// be a power of two
+std::vector<int> hilbert_order(int nbins);
+
+// Hilbert distance of cell (cx, cy, cz) of a 2^level grid (level <= 21),
+// the inverse of hilbert_order: hilbert_order(2^level)[hilbert_key(c)] is
+// the cell index of c. Keys nest: the key of a cell shifted right by 3
+// bits is the key of its parent cell on the grid of half the resolution.
+uint64_t hilbert_key(uint32_t cx, uint32_t cy, uint32_t cz, int level);
+
+// Cell of coordinate v on a grid of cells cells over [0, box_size], with
+// the edges of np.histogramdd (right edge inclusive); -1 if outside
+int grid_cell(double v, int cells, double box_size);
+
+// Append a cell count in the binned encoding (decimal, or '0' + count)
+void append_cell(std::string& binned, int count, bool one_symbol_per_cell);
+
+// Particle counts of the nbins^3 cells of [0, box_size]^3 in Hilbert order,
+// written as decimal counts (the Python default) or, with
+// one_symbol_per_cell, as the single symbol '0' + count
+std::string bin_particles(const std::vector<Particle>& particles, int nbins, double box_size,
+                          const std::vector<int>& order, bool one_symbol_per_cell = false);
+
+#endif // BINNING_H
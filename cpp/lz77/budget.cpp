@@ -0,0 +1,122 @@
+// budget.cpp - Memory-budget-aware engine and thread selection
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+#include "budget.h"
+#include "parallel.h"
+#include "streaming.h"
+
+long long parse_size(const std::string& text) {
+    size_t used = 0;
+    double value = 0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception&) {
+        throw std::runtime_error("Invalid size: " + text);
+    }
+    std::string unit = text.substr(used);
+    long long scale = 1;
+    if (!unit.empty()) {
+        const std::string units = "KMGT";
+        size_t k = units.find(std::toupper(static_cast<unsigned char>(unit[0])));
+        if (k == std::string::npos || unit.size() > 2 ||
+            (unit.size() == 2 && std::toupper(static_cast<unsigned char>(unit[1])) != 'B')) {
+            throw std::runtime_error("Invalid size: " + text);
+        }
+        scale = 1LL << (10 * (k + 1));
+    }
+    if (value <= 0) {
+        throw std::runtime_error("Size must be positive: " + text);
+    }
+    return static_cast<long long>(value * scale);
+}
+
+long long suffix_array_bytes(long long length) {
+    // sa, psv, nsv, psv_lcp, nsv_lcp
+    return 5 * static_cast<long long>(sizeof(int)) * length;
+}
+
+long long windowed_bytes(int window) {
+    // 3W buffer and the W-slot hash chain, then the hash head, last symbol
+    // and last two symbol pair tables
+    long long per_symbol = 3 + sizeof(long long);
+    long long tables = ((1LL << 16) + (1 << 8) + 2 * (1LL << 16)) * sizeof(long long);
+    return per_symbol * window + tables;
+}
+
+EnginePlan plan_cid(long long length, long long budget, long long resident, bool streamed) {
+    EnginePlan plan = {ENGINE_SUFFIX_ARRAY, 0, 1, resident + suffix_array_bytes(length),
+                       budget};
+    if (plan.peak_bytes <= budget) {
+        return plan;
+    }
+
+    // Largest power-of-two window that fits; a streamed input is not held
+    long long held = streamed ? 0 : resident;
+    int window = 1 << 30;
+    while (window >= 16 && held + windowed_bytes(window) > budget) {
+        window /= 2;
+    }
+    if (window < 16) {
+        throw std::runtime_error("Memory budget too small for any engine");
+    }
+    // No point in a window longer than the input
+    while (window > 16 && window / 2 >= length) {
+        window /= 2;
+    }
+    plan.engine = ENGINE_WINDOWED;
+    plan.window = window;
+    plan.peak_bytes = held + windowed_bytes(window);
+    return plan;
+}
+
+int plan_threads(long long budget, long long resident, long long per_worker,
+                 int n_threads, size_t n_jobs) {
+    long long fit = per_worker > 0 ? (budget - resident) / per_worker : n_jobs;
+    if (fit < 1) {
+        throw std::runtime_error("Memory budget too small for one worker");
+    }
+    return static_cast<int>(std::min<long long>(resolve_threads(n_threads, n_jobs), fit));
+}
+
+const char* engine_name(Engine engine) {
+    return engine == ENGINE_SUFFIX_ARRAY ? "suffix_array" : "windowed";
+}
+
+std::string describe_plan(const EnginePlan& plan) {
+    std::ostringstream out;
+    out << "Engine: ";
+    if (plan.engine == ENGINE_SUFFIX_ARRAY) {
+        out << "suffix array (exact)";
+    } else {
+        out << "windowed, window " << plan.window;
+    }
+    out << ", " << plan.n_threads << (plan.n_threads == 1 ? " thread" : " threads")
+        << ", est. peak " << plan.peak_bytes / 1048576.0 << " MB of "
+        << plan.budget / 1048576.0 << " MB budget";
+    return out.str();
+}
+
+CompressionStats compute_cid_budgeted(const unsigned char* text, int length, Workspace& ws,
+                                      long long budget, const CidOptions& options,
+                                      EnginePlan* plan) {
+    EnginePlan chosen = plan_cid(length, budget, length);
+    if (plan) {
+        *plan = chosen;
+    }
+    if (chosen.engine == ENGINE_SUFFIX_ARRAY) {
+        return compute_cid(text, length, ws, options);
+    }
+    if (length <= 0) {
+        throw std::runtime_error("Empty input");
+    }
+    StreamOptions stream;
+    stream.window = chosen.window;
+    StreamingParser parser(stream);
+    parser.append(text, length);
+    parser.finish();
+    return make_stats(parser.parse(), length, options);
+}
@@ -0,0 +1,65 @@
+// budget.h - Engine and thread count that keep a run under a memory budget
+// The suffix-array engine holds five int arrays per input symbol (SA, PSV,
+// NSV and their LCPs, ~20n bytes on top of the input), so a grid that fits
+// one node at 128^3 may not at 512^3. Given a budget in bytes, the planner
+// keeps the exact engine while it fits, falls back to the windowed parse of
+// streaming.h (O(W), input streamed) otherwise, and caps the worker count
+// of shuffles and batches so that all workers fit together.
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <string>
+
+#include "lz77.h"
+
+enum Engine {
+    ENGINE_SUFFIX_ARRAY,   // exact greedy parse
+    ENGINE_WINDOWED        // sources at most window symbols back
+};
+
+struct EnginePlan {
+    Engine engine;
+    int window;            // ENGINE_WINDOWED only
+    int n_threads;         // workers for shuffles or batch rows, 1 otherwise
+    long long peak_bytes;  // estimated peak of the planned run
+    long long budget;
+};
+
+// "1073741824", "512M", "4G" (powers of 1024; K, M, G, T)
+long long parse_size(const std::string& text);
+
+// Workspace of compute_cid for length symbols, not counting the input
+long long suffix_array_bytes(long long length);
+
+// StreamingParser with this window, including its fixed-size tables
+long long windowed_bytes(int window);
+
+// Engine for one input of length symbols. resident is memory already in
+// use (e.g. the input itself); streamed says whether the windowed engine
+// may read the input from disk instead of holding it. Throws if not even
+// the smallest window fits.
+EnginePlan plan_cid(long long length, long long budget, long long resident = 0,
+                    bool streamed = false);
+
+// Workers for n_jobs jobs that each need per_worker bytes, with resident
+// bytes held throughout: n_threads (0 = all cores) capped by the budget.
+// Throws if one worker does not fit.
+int plan_threads(long long budget, long long resident, long long per_worker,
+                 int n_threads, size_t n_jobs);
+
+// "suffix_array" or "windowed", for -t and --json output
+const char* engine_name(Engine engine);
+
+// One line for logs: engine, window, threads and estimated peak
+std::string describe_plan(const EnginePlan& plan);
+
+// compute_cid of an in-memory input within budget bytes (input included);
+// the windowed engine replaces the suffix array when that does not fit.
+// The plan used is stored in plan if given.
+CompressionStats compute_cid_budgeted(const unsigned char* text, int length, Workspace& ws,
+                                      long long budget,
+                                      const CidOptions& options = CidOptions(),
+                                      EnginePlan* plan = nullptr);
+
+#endif // BUDGET_H
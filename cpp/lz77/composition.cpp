@@ -0,0 +1,138 @@
+// composition.cpp - Multi-type grids encoded as one composition symbol per cell
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "composition.h"
+
+namespace {
+
+// Composition -> number, with linear probing over a power-of-two slot
+// array kept at most half full. Rows are stored back to back in rows, so
+// the table is also the dictionary.
+class CompositionTable {
+public:
+    CompositionTable(size_t width, std::vector<uint32_t>& rows)
+        : width_(width), rows_(rows), slots_(64, -1) {}
+
+    int find_or_add(const uint32_t* counts) {
+        size_t mask = slots_.size() - 1;
+        for (size_t slot = hash(counts) & mask;; slot = (slot + 1) & mask) {
+            int id = slots_[slot];
+            if (id < 0) {
+                return add(counts, slot);
+            }
+            if (std::equal(counts, counts + width_, rows_.begin() + id * width_)) {
+                return id;
+            }
+        }
+    }
+
+private:
+    uint64_t hash(const uint32_t* counts) const {
+        uint64_t h = 14695981039346656037ull;   // FNV-1a over the counts
+        for (size_t k = 0; k < width_; k++) {
+            h = (h ^ counts[k]) * 1099511628211ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    int add(const uint32_t* counts, size_t slot) {
+        int id = static_cast<int>(rows_.size() / width_);
+        if (static_cast<size_t>(id) >= MAX_COMPOSITIONS) {
+            throw std::runtime_error("More than " + std::to_string(MAX_COMPOSITIONS) +
+                                     " distinct cell compositions");
+        }
+        rows_.insert(rows_.end(), counts, counts + width_);
+        slots_[slot] = id;
+        if (2 * (static_cast<size_t>(id) + 1) > slots_.size()) {
+            grow();
+        }
+        return id;
+    }
+
+    void grow() {
+        std::vector<int> old(slots_.size() * 2, -1);
+        old.swap(slots_);
+        size_t mask = slots_.size() - 1;
+        for (int id : old) {
+            if (id >= 0) {
+                size_t slot = hash(&rows_[id * width_]) & mask;
+                while (slots_[slot] >= 0) {
+                    slot = (slot + 1) & mask;
+                }
+                slots_[slot] = id;
+            }
+        }
+    }
+
+    size_t width_;
+    std::vector<uint32_t>& rows_;
+    std::vector<int> slots_;
+};
+
+}  // namespace
+
+std::string CompositionCells::encode() const {
+    std::string encoded;
+    if (symbol_bytes() == 1) {
+        encoded.assign(symbols.begin(), symbols.end());
+    } else {
+        encoded.reserve(2 * symbols.size());
+        for (uint16_t symbol : symbols) {
+            encoded.push_back(static_cast<char>(symbol >> 8));
+            encoded.push_back(static_cast<char>(symbol & 0xff));
+        }
+    }
+    return encoded;
+}
+
+CompositionCells composition_cells(const SortedParticles& sorted, int nbins) {
+    int bits = 0;
+    while ((1 << bits) < nbins) {
+        bits++;
+    }
+    if (nbins < 2 || (1 << bits) != nbins || bits > sorted.level) {
+        throw std::runtime_error("Number of bins must be a power of two no larger than the "
+                                 "grid of the keys");
+    }
+    CompositionCells cells;
+    cells.types.assign(sorted.type.begin(), sorted.type.begin() + sorted.inside);
+    std::sort(cells.types.begin(), cells.types.end());
+    cells.types.erase(std::unique(cells.types.begin(), cells.types.end()), cells.types.end());
+    if (cells.types.empty()) {
+        cells.types.push_back(0);   // empty box: one composition, no particles
+    }
+    std::vector<uint32_t> rank(sorted.inside);
+    for (size_t i = 0; i < sorted.inside; i++) {
+        rank[i] = std::lower_bound(cells.types.begin(), cells.types.end(), sorted.type[i]) -
+                  cells.types.begin();
+    }
+
+    size_t width = cells.types.size();
+    CompositionTable table(width, cells.compositions);
+    std::vector<uint32_t> counts(width, 0);
+    int empty = -1;   // number of the empty composition, once seen
+    int shift = 3 * (sorted.level - bits);
+    uint64_t n_cells = uint64_t(1) << (3 * bits);
+    cells.symbols.reserve(n_cells);
+    size_t i = 0;
+    for (uint64_t cell = 0; cell < n_cells; cell++) {
+        size_t first = i;
+        while (i < sorted.inside && (sorted.keys[i] >> shift) == cell) {
+            counts[rank[i++]]++;
+        }
+        if (i == first) {
+            if (empty < 0) {
+                empty = table.find_or_add(counts.data());
+            }
+            cells.symbols.push_back(static_cast<uint16_t>(empty));
+            continue;
+        }
+        cells.symbols.push_back(static_cast<uint16_t>(table.find_or_add(counts.data())));
+        for (size_t k = first; k < i; k++) {
+            counts[rank[k]] = 0;
+        }
+    }
+    return cells;
+}
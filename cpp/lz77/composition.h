@@ -0,0 +1,37 @@
+// composition.h - Multi-type grids encoded as one composition symbol per cell
+// Per-type CIDs bin every species on its own grid and miss correlations
+// between species that share a cell. composition_cells instead gives each
+// cell the number of its composition (the count of every particle type,
+// e.g. "1 Zn + 2 N"), numbered in order of first appearance along the
+// Hilbert curve through a small open-addressing table, so one pass over
+// Hilbert-sorted particles yields one symbol per cell over a compact
+// alphabet of the compositions actually present.
+
+#ifndef COMPOSITION_H
+#define COMPOSITION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "hilbert.h"
+
+constexpr size_t MAX_COMPOSITIONS = 65536;   // uint16 symbols
+
+struct CompositionCells {
+    std::vector<uint16_t> symbols;        // one per cell, in Hilbert order
+    std::vector<int> types;               // types present, ascending
+    std::vector<uint32_t> compositions;   // size() rows of types.size() counts
+
+    size_t size() const { return types.empty() ? 0 : compositions.size() / types.size(); }
+    // Bytes for the CID engine: one per cell up to 256 compositions, else
+    // two per cell (high byte first)
+    int symbol_bytes() const { return size() <= 256 ? 1 : 2; }
+    std::string encode() const;
+};
+
+// Compositions of the nbins^3 cells of the grid of sorted (nbins a power
+// of two no larger than 2^sorted.level); throws past MAX_COMPOSITIONS
+CompositionCells composition_cells(const SortedParticles& sorted, int nbins);
+
+#endif // COMPOSITION_H
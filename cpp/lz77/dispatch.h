@@ -0,0 +1,40 @@
+// dispatch.h - Runtime CPU feature dispatch for the hot kernels
+// The binaries are built for the baseline x86-64 ISA so that one build runs
+// on every node of a mixed cluster. Functions marked HOT_KERNEL are
+// compiled once per ISA level instead (AVX-512, AVX2, SSE4.2 and the
+// baseline) and the loader picks the best clone for the CPU at startup
+// through an ifunc resolver, so -march=native is not needed for near-native
+// speed. The resolvers get default visibility whatever the attributes say,
+// so libkappa hides them with its version script (kappa.map). Elsewhere
+// (other architectures, macOS without ifunc, or make KERNEL_CLONES=0)
+// HOT_KERNEL is empty.
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GNUC__) && !defined(LZ_NO_CLONES)
+#define HOT_KERNEL __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#define HOT_KERNEL_CLONES 1
+#else
+#define HOT_KERNEL
+#define HOT_KERNEL_CLONES 0
+#endif
+
+// ISA level the hot kernels run at on this CPU, for verbose output
+inline const char* kernel_isa() {
+#if HOT_KERNEL_CLONES
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return "avx512f";
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return "sse4.2";
+    }
+#endif
+    return "baseline";
+}
+
+#endif // DISPATCH_H
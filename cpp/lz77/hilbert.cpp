@@ -0,0 +1,186 @@
+// hilbert.cpp - Particles reordered along the 3D Hilbert curve
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "hilbert.h"
+#include "parallel.h"
+#include "profile.h"
+
+namespace {
+
+constexpr int RADIX_BITS = 8;
+constexpr int RADIX = 1 << RADIX_BITS;
+// Below this many particles per extra thread, threads cost more than they save
+constexpr size_t MIN_PARTICLES_PER_THREAD = 1 << 16;
+
+// Stable LSD radix sort of (keys, index) by the low key_bits bits of the
+// keys. Every pass splits the range in one chunk per worker: each counts
+// its digits, a prefix sum over (digit, chunk) gives every chunk its
+// output slots, and the chunks scatter in parallel.
+void radix_sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& index, int key_bits,
+                int n_workers) {
+    size_t n = keys.size();
+    std::vector<uint64_t> keys_out(n);
+    std::vector<uint32_t> index_out(n);
+    std::vector<std::array<size_t, RADIX>> counts(n_workers);
+    auto chunk_begin = [&](int w) { return n * w / n_workers; };
+
+    for (int shift = 0; shift < key_bits; shift += RADIX_BITS) {
+        parallel_for(n_workers, n_workers, [&](size_t w, int) {
+            counts[w].fill(0);
+            for (size_t i = chunk_begin(w); i < chunk_begin(w + 1); i++) {
+                counts[w][(keys[i] >> shift) & (RADIX - 1)]++;
+            }
+        });
+        // A digit shared by every key leaves the order unchanged
+        size_t total_first = 0;
+        for (int w = 0; w < n_workers; w++) {
+            total_first += counts[w][(keys[0] >> shift) & (RADIX - 1)];
+        }
+        if (total_first == n) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int digit = 0; digit < RADIX; digit++) {
+            for (int w = 0; w < n_workers; w++) {
+                size_t count = counts[w][digit];
+                counts[w][digit] = offset;
+                offset += count;
+            }
+        }
+        parallel_for(n_workers, n_workers, [&](size_t w, int) {
+            auto& next = counts[w];
+            for (size_t i = chunk_begin(w); i < chunk_begin(w + 1); i++) {
+                size_t slot = next[(keys[i] >> shift) & (RADIX - 1)]++;
+                keys_out[slot] = keys[i];
+                index_out[slot] = index[i];
+            }
+        });
+        keys.swap(keys_out);
+        index.swap(index_out);
+    }
+}
+
+}  // namespace
+
+SortedParticles hilbert_sort(const std::vector<Particle>& particles, double box_size,
+                             int level, int n_threads) {
+    PROFILE_PHASE("hilbert_sort");
+    if (level < 1 || level > MAX_HILBERT_LEVEL) {
+        throw std::runtime_error("Hilbert level must be in [1, " +
+                                 std::to_string(MAX_HILBERT_LEVEL) + "]");
+    }
+    if (!(box_size > 0)) {
+        throw std::runtime_error("Box size must be positive");
+    }
+    if (particles.size() > UINT32_MAX) {
+        throw std::runtime_error("Too many particles to sort");
+    }
+    SortedParticles sorted;
+    sorted.level = level;
+    sorted.box_size = box_size;
+    size_t n = particles.size();
+    if (n == 0) {
+        return sorted;
+    }
+    int n_workers = resolve_threads(n_threads, n / MIN_PARTICLES_PER_THREAD);
+    int cells = 1 << level;
+    uint64_t outside = sorted.outside_key();
+
+    sorted.keys.resize(n);
+    sorted.permutation.resize(n);
+    std::vector<size_t> inside(n_workers, 0);
+    parallel_for(n_workers, n_workers, [&](size_t w, int) {
+        for (size_t i = n * w / n_workers; i < n * (w + 1) / n_workers; i++) {
+            const Particle& p = particles[i];
+            int cx = grid_cell(p.x, cells, box_size);
+            int cy = grid_cell(p.y, cells, box_size);
+            int cz = grid_cell(p.z, cells, box_size);
+            bool in_box = cx >= 0 && cy >= 0 && cz >= 0;
+            sorted.keys[i] = in_box ? hilbert_key(cx, cy, cz, level) : outside;
+            sorted.permutation[i] = static_cast<uint32_t>(i);
+            inside[w] += in_box;
+        }
+    });
+    for (size_t count : inside) {
+        sorted.inside += count;
+    }
+    // One bit above the cell keys holds the outside marker
+    radix_sort(sorted.keys, sorted.permutation, 3 * level + 1, n_workers);
+
+    sorted.x.resize(n);
+    sorted.y.resize(n);
+    sorted.z.resize(n);
+    sorted.type.resize(n);
+    parallel_for(n_workers, n_workers, [&](size_t w, int) {
+        for (size_t i = n * w / n_workers; i < n * (w + 1) / n_workers; i++) {
+            const Particle& p = particles[sorted.permutation[i]];
+            sorted.x[i] = p.x;
+            sorted.y[i] = p.y;
+            sorted.z[i] = p.z;
+            sorted.type[i] = p.type;
+        }
+    });
+    return sorted;
+}
+
+std::string bin_sorted(const uint64_t* keys, size_t count, int level, int nbins,
+                       bool one_symbol_per_cell) {
+    int bits = 0;
+    while ((1 << bits) < nbins) {
+        bits++;
+    }
+    if (nbins < 2 || (1 << bits) != nbins || bits > level) {
+        throw std::runtime_error("Number of bins must be a power of two no larger than the "
+                                 "grid of the keys");
+    }
+    int shift = 3 * (level - bits);
+    uint64_t cells = uint64_t(1) << (3 * bits);
+    std::string binned;
+    binned.reserve(cells);
+    size_t i = 0;
+    for (uint64_t cell = 0; cell < cells; cell++) {
+        size_t first = i;
+        while (i < count && (keys[i] >> shift) == cell) {
+            i++;
+        }
+        append_cell(binned, static_cast<int>(i - first), one_symbol_per_cell);
+    }
+    return binned;
+}
+
+std::string type_sequence(const SortedParticles& sorted) {
+    std::vector<int> types(sorted.type.begin(), sorted.type.begin() + sorted.inside);
+    std::sort(types.begin(), types.end());
+    types.erase(std::unique(types.begin(), types.end()), types.end());
+    if (types.size() > 255 - '0') {
+        throw std::runtime_error("Too many particle types for one symbol each");
+    }
+    std::string sequence(sorted.inside, '0');
+    for (size_t i = 0; i < sorted.inside; i++) {
+        size_t rank = std::lower_bound(types.begin(), types.end(), sorted.type[i]) - types.begin();
+        sequence[i] = static_cast<char>('0' + rank);
+    }
+    return sequence;
+}
+
+std::string key_gap_stream(const SortedParticles& sorted, int quantize_bits) {
+    if (quantize_bits < 0 || quantize_bits > 3 * sorted.level) {
+        throw std::runtime_error("Quantization must be in [0, 3 * level] bits");
+    }
+    std::string stream;
+    stream.reserve(sorted.inside * 2);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < sorted.inside; i++) {
+        uint64_t gap = (sorted.keys[i] - previous) >> quantize_bits;
+        previous = sorted.keys[i];
+        while (gap >= 0x80) {
+            stream.push_back(static_cast<char>(0x80 | (gap & 0x7f)));
+            gap >>= 7;
+        }
+        stream.push_back(static_cast<char>(gap));
+    }
+    return stream;
+}
@@ -0,0 +1,66 @@
+// hilbert.h - Particles reordered along the 3D Hilbert curve
+// A frame comes out of the readers in file order, which for a melt or a
+// mixture is spatially random, so every analysis that walks the particles
+// (binning, per-type filtering, neighbor searches) touches memory at
+// random. hilbert_sort computes the Hilbert key of every particle on a
+// fine 2^level grid and radix-sorts the particles by key into
+// structure-of-arrays form, in parallel, keeping the permutation. Keys
+// nest (binning.h), so the histogram of any coarser power-of-two grid is
+// then one streaming pass over the sorted keys, already in Hilbert order
+// and without an order table or a count array (bin_sorted).
+
+#ifndef HILBERT_H
+#define HILBERT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "binning.h"
+
+constexpr int MAX_HILBERT_LEVEL = 21;   // 63-bit keys
+
+struct SortedParticles {
+    int level = 0;                       // keys are cells of a 2^level grid
+    double box_size = 0;
+    size_t inside = 0;                   // particles in the box, sorted first
+    std::vector<uint64_t> keys;          // ascending; outside_key() past inside
+    std::vector<double> x, y, z;
+    std::vector<int> type;
+    std::vector<uint32_t> permutation;   // input index of each sorted particle
+
+    size_t size() const { return keys.size(); }
+    // Key of particles outside [0, box_size]^3, above every cell's key
+    uint64_t outside_key() const { return uint64_t(1) << (3 * level); }
+};
+
+// Sort particles along the Hilbert curve of the 2^level grid over
+// [0, box_size]^3 (1 <= level <= MAX_HILBERT_LEVEL) on n_threads threads
+// (0 = all cores). The sort is stable: particles of one cell keep their
+// input order.
+SortedParticles hilbert_sort(const std::vector<Particle>& particles, double box_size,
+                             int level = 10, int n_threads = 0);
+
+// Same string as bin_particles(particles, nbins, box_size, hilbert_order(nbins))
+// from the ascending keys of the particles on the 2^level grid (those of a
+// SortedParticles; outside keys are not counted); nbins must be a power of
+// two no larger than 2^level
+std::string bin_sorted(const uint64_t* keys, size_t count, int level, int nbins,
+                       bool one_symbol_per_cell = false);
+
+// Types of the particles in the box in curve order, one symbol per
+// particle: the k-th smallest type present becomes '0' + k. Its CID
+// against shuffled copies measures compositional order without a grid,
+// for the cost of one sort of the particles whatever the resolution.
+std::string type_sequence(const SortedParticles& sorted);
+
+// Gaps between the consecutive keys of the particles in the box (the first
+// from key 0), shifted right by quantize_bits and written as LEB128
+// varints: 7 bits per byte, low bits first, the high bit set on every byte
+// but the last. A histogram keeps only counts per cell; the gaps keep the
+// position of every particle to the key resolution, and the stream grows
+// with the number of particles instead of the number of cells. Dropping
+// low gap bits trades that resolution for repeats the parser can find.
+std::string key_gap_stream(const SortedParticles& sorted, int quantize_bits = 0);
+
+#endif // HILBERT_H
@@ -0,0 +1,125 @@
+// hugepage.cpp - Huge-page backed allocation for the large engine buffers
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "hugepage.h"
+#include "profile.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+std::atomic<int> current_mode(HUGE_PAGES_SYSTEM);
+
+// Every large buffer is mapped with this length whatever the mode, so a
+// buffer can be freed after the mode has changed
+size_t mapped_length(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+}  // namespace
+
+void set_huge_pages(HugePageMode mode) {
+    current_mode = mode;
+}
+
+HugePageMode huge_pages() {
+    return static_cast<HugePageMode>(current_mode.load());
+}
+
+HugePageMode parse_huge_pages(const std::string& name) {
+    for (HugePageMode mode : {HUGE_PAGES_SYSTEM, HUGE_PAGES_NONE, HUGE_PAGES_THP,
+                              HUGE_PAGES_EXPLICIT}) {
+        if (name == huge_pages_name(mode)) {
+            return mode;
+        }
+    }
+    throw std::runtime_error("Unknown huge page mode: " + name +
+                             " (system, none, thp or explicit)");
+}
+
+const char* huge_pages_name(HugePageMode mode) {
+    switch (mode) {
+        case HUGE_PAGES_NONE: return "none";
+        case HUGE_PAGES_THP: return "thp";
+        case HUGE_PAGES_EXPLICIT: return "explicit";
+        default: return "system";
+    }
+}
+
+#ifdef __linux__
+
+void* allocate_buffer(size_t bytes) {
+    profile_note_allocation(bytes);
+    if (bytes < HUGE_PAGE_SIZE) {
+        if (void* p = std::malloc(bytes ? bytes : 1)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+    size_t length = mapped_length(bytes);
+    HugePageMode mode = huge_pages();
+
+    if (mode == HUGE_PAGES_EXPLICIT) {
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            return p;
+        }
+        mode = HUGE_PAGES_THP;   // no reserved pages left
+    }
+
+    // Map one huge page more and trim both ends to a huge-page boundary,
+    // which THP needs to back the range with huge pages
+    void* raw = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    size_t tail = start + length + HUGE_PAGE_SIZE - (aligned + length);
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + length), tail);
+    }
+    void* p = reinterpret_cast<void*>(aligned);
+    if (mode == HUGE_PAGES_THP) {
+        madvise(p, length, MADV_HUGEPAGE);
+    } else if (mode == HUGE_PAGES_NONE) {
+        madvise(p, length, MADV_NOHUGEPAGE);
+    }
+    return p;
+}
+
+void free_buffer(void* p, size_t bytes) {
+    if (bytes < HUGE_PAGE_SIZE) {
+        std::free(p);
+    } else {
+        munmap(p, mapped_length(bytes));
+    }
+}
+
+#else
+
+// No huge-page control: plain malloc whatever the mode
+void* allocate_buffer(size_t bytes) {
+    profile_note_allocation(bytes);
+    if (void* p = std::malloc(bytes ? bytes : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void free_buffer(void* p, size_t) {
+    std::free(p);
+}
+
+#endif // __linux__
@@ -0,0 +1,55 @@
+// hugepage.h - Huge-page backed allocation for the large engine buffers
+// The suffix array and the PSV/NSV/LCP arrays are read at random positions
+// (divsufsort, the Kasai-style LCP passes), so on inputs of 128^3 cells and
+// up a good share of their cost is TLB misses. Buffers of at least
+// HUGE_PAGE_SIZE bytes are mapped directly, aligned to a huge page, and
+// the page size follows the process-wide mode set with set_huge_pages();
+// smaller ones use malloc as before.
+
+#ifndef HUGEPAGE_H
+#define HUGEPAGE_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+enum HugePageMode {
+    HUGE_PAGES_SYSTEM,     // leave it to the kernel's THP policy (default)
+    HUGE_PAGES_NONE,       // standard pages only (MADV_NOHUGEPAGE)
+    HUGE_PAGES_THP,        // transparent huge pages (MADV_HUGEPAGE)
+    HUGE_PAGES_EXPLICIT    // reserved 2 MB pages (MAP_HUGETLB), THP if none free
+};
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+void set_huge_pages(HugePageMode mode);
+HugePageMode huge_pages();
+
+// "system", "none", "thp" or "explicit"
+HugePageMode parse_huge_pages(const std::string& name);
+const char* huge_pages_name(HugePageMode mode);
+
+// Large buffers are whole huge pages; the pointer is huge-page aligned.
+// Throws std::bad_alloc on failure.
+void* allocate_buffer(size_t bytes);
+void free_buffer(void* p, size_t bytes);
+
+// std::vector allocator over allocate_buffer
+template <typename T>
+struct BufferAllocator {
+    using value_type = T;
+
+    BufferAllocator() = default;
+    template <typename U>
+    BufferAllocator(const BufferAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(allocate_buffer(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { free_buffer(p, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const BufferAllocator<T>&, const BufferAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const BufferAllocator<T>&, const BufferAllocator<U>&) { return false; }
+
+#endif // HUGEPAGE_H
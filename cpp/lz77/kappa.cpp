@@ -0,0 +1,551 @@
+// kappa.cpp - C API of libkappa over the C++ engine
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "batch.h"
+#include "binning.h"
+#include "composition.h"
+#include "hilbert.h"
+#include "kappa.h"
+#include "lz77.h"
+#include "pool.h"
+#include "shuffle.h"
+#include "trace.h"
+
+struct kappa_workspace {
+    Workspace ws;
+};
+
+struct kappa_pool {
+    std::mutex mutex;
+    std::unordered_map<long long, kappa_result> results;   // finished, not collected
+    // Last, so it is destroyed first: ~JobPool joins the workers, whose
+    // running jobs still store into results
+    JobPool jobs;
+
+    kappa_pool(int n_threads, int max_in_flight) : jobs(n_threads, max_in_flight) {}
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+// Input file that cannot be opened or parsed
+struct io_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Run fn, turning exceptions into a status and the thread's error message
+template <typename Fn>
+kappa_status guarded(Fn fn) {
+    try {
+        last_error.clear();
+        fn();
+        return KAPPA_OK;
+    } catch (const std::bad_alloc&) {
+        last_error = "Out of memory";
+        return KAPPA_ERROR_OUT_OF_MEMORY;
+    } catch (const std::invalid_argument& e) {
+        last_error = e.what();
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    } catch (const io_error& e) {
+        last_error = e.what();
+        return KAPPA_ERROR_IO;
+    } catch (const std::runtime_error& e) {
+        // The engine reports unusable input (empty, wrong encoding) this way
+        last_error = e.what();
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    } catch (const std::exception& e) {
+        last_error = e.what();
+        return KAPPA_ERROR_INTERNAL;
+    } catch (...) {
+        last_error = "Unknown error";
+        return KAPPA_ERROR_INTERNAL;
+    }
+}
+
+void require(bool condition, const char* message) {
+    if (!condition) {
+        throw std::invalid_argument(message);
+    }
+}
+
+CidOptions cid_options(const kappa_options* options) {
+    CidOptions cid;
+    if (options) {
+        require(options->cost >= KAPPA_COST_KKP && options->cost <= KAPPA_COST_FIXED,
+                "Unknown cost model");
+        cid.variant = options->overlap ? OVERLAPPING : NON_OVERLAPPING;
+        cid.cost = static_cast<CostModel>(options->cost);
+    }
+    return cid;
+}
+
+kappa_stats to_c(const CompressionStats& stats) {
+    return {stats.length, stats.factors, stats.compressed_bits, stats.cid};
+}
+
+// Hilbert orders are the same for every call with the same grid
+const std::vector<int>& cached_hilbert_order(int nbins) {
+    static std::mutex mutex;
+    static std::map<int, std::vector<int>> orders;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = orders.find(nbins);
+    if (it == orders.end()) {
+        it = orders.emplace(nbins, hilbert_order(nbins)).first;
+    }
+    return it->second;
+}
+
+void require_grid(int nbins, double box_size) {
+    require(nbins >= 2 && nbins <= 1024 && (nbins & (nbins - 1)) == 0,
+            "Number of bins must be a power of two in [2, 1024]");
+    require(box_size > 0, "Box size must be positive");
+}
+
+// Where a pool job takes its input from
+struct JobInput {
+    std::string filename;        // empty for a caller buffer
+    const uint8_t* data = nullptr;
+    int64_t length = 0;
+};
+
+// Read, bin, parse and shuffle one pool job; throws on failure
+void run_job(long long id, const JobInput& input, const kappa_job& job, Workspace& ws,
+             kappa_result& result) {
+    CidOptions options = cid_options(&job.options);
+    std::string symbols;
+    const uint8_t* text = input.data;
+    int64_t length = input.length;
+
+    if (job.input == KAPPA_INPUT_SYMBOLS && !input.filename.empty()) {
+        TraceSpan span("read", id, 0);
+        std::ifstream file(input.filename, std::ios::binary);
+        if (!file) {
+            throw io_error("Cannot open file: " + input.filename);
+        }
+        symbols.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        span.set_size(symbols.size());
+    } else if (job.input == KAPPA_INPUT_XYZ || job.input == KAPPA_INPUT_LAMMPS) {
+        require(!input.filename.empty(), "Particle inputs must be files");
+        std::vector<Particle> particles;
+        double box_size = job.box_size;
+        {
+            TraceSpan span("read", id, 0);
+            try {
+                particles = job.input == KAPPA_INPUT_XYZ
+                                ? read_xyz(input.filename)
+                                : read_lammps_data(input.filename,
+                                                   job.box_size > 0 ? nullptr : &box_size);
+            } catch (const std::runtime_error& e) {
+                throw io_error(e.what());
+            }
+            span.set_size(particles.size());
+        }
+        require_grid(job.nbins, box_size);
+        TraceSpan span("bin", id, particles.size());
+        symbols = bin_particles(particles, job.nbins, box_size,
+                                cached_hilbert_order(job.nbins), job.one_symbol_per_cell);
+    } else {
+        require(job.input == KAPPA_INPUT_SYMBOLS, "Unknown input kind");
+    }
+    if (text == nullptr) {
+        text = reinterpret_cast<const uint8_t*>(symbols.data());
+        length = symbols.size();
+    }
+    require(length > 0 && length <= INT_MAX, "Length must be in [1, 2^31)");
+
+    {
+        TraceSpan span("cid", id, length);
+        result.stats = to_c(compute_cid(text, static_cast<int>(length), ws, options));
+    }
+    if (job.n_shuffles > 0) {
+        // One thread per job: the pool's workers are the parallelism
+        auto baselines = compute_baselines(text, static_cast<int>(length),
+                                           {parse_null_model("perm")}, job.n_shuffles,
+                                           job.seed, 1, options);
+        double sum = 0, sum_squares = 0;
+        for (const auto& b : baselines) {
+            sum += b.stats.cid;
+            sum_squares += b.stats.cid * b.stats.cid;
+        }
+        double mean = sum / baselines.size();
+        result.cid_shuffled = mean;
+        result.cid_shuffled_std =
+            std::sqrt(std::max(0.0, sum_squares / baselines.size() - mean * mean));
+    }
+}
+
+kappa_status submit_job(kappa_pool* pool, JobInput input, const kappa_job* job, int64_t* id) {
+    return guarded([&]() {
+        require(pool && job && id, "Null argument");
+        kappa_job params = *job;
+        cid_options(&params.options);   // reject a bad cost model now, not in the job
+        long long submitted = pool->jobs.submit([pool, input, params](long long job_id,
+                                                                      Workspace& ws) {
+            kappa_result result = {};
+            result.id = job_id;
+            auto start = std::chrono::steady_clock::now();
+            result.status = guarded([&]() { run_job(job_id, input, params, ws, result); });
+            result.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+            if (result.status != KAPPA_OK) {
+                std::strncpy(result.error, last_error.c_str(), sizeof(result.error) - 1);
+            }
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->results[job_id] = result;
+        });
+        if (submitted == 0) {
+            throw std::invalid_argument("Pool is closed");
+        }
+        *id = submitted;
+    });
+}
+
+std::vector<Particle> to_particles(const kappa_particle* particles, int64_t count) {
+    std::vector<Particle> input(count);
+    for (int64_t k = 0; k < count; k++) {
+        input[k] = {particles[k].type, particles[k].x, particles[k].y, particles[k].z};
+    }
+    return input;
+}
+
+// Run fn, which returns a binned string, and copy it to out if it fits in
+// capacity; *length receives its length either way
+template <typename Fn>
+kappa_status guarded_output(uint8_t* out, int64_t capacity, int64_t* length, Fn fn) {
+    bool too_small = false;
+    kappa_status status = guarded([&]() {
+        require(out && length, "Null argument");
+        std::string binned = fn();
+        *length = binned.size();
+        if (static_cast<int64_t>(binned.size()) > capacity) {
+            too_small = true;
+            return;
+        }
+        std::memcpy(out, binned.data(), binned.size());
+    });
+    if (status == KAPPA_OK && too_small) {
+        last_error = "Output buffer too small";
+        return KAPPA_ERROR_BUFFER_TOO_SMALL;
+    }
+    return status;
+}
+
+// Copy particles read by a reader to a buffer for kappa_free
+kappa_status copy_particles(const std::vector<Particle>& read, kappa_particle** particles,
+                            int64_t* count) {
+    auto* out = static_cast<kappa_particle*>(
+        std::malloc(sizeof(kappa_particle) * (read.empty() ? 1 : read.size())));
+    if (!out) {
+        last_error = "Out of memory";
+        return KAPPA_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t k = 0; k < read.size(); k++) {
+        out[k] = {read[k].type, read[k].x, read[k].y, read[k].z};
+    }
+    *particles = out;
+    *count = read.size();
+    return KAPPA_OK;
+}
+
+}  // namespace
+
+extern "C" {
+
+int kappa_abi_version(void) {
+    return KAPPA_ABI_VERSION;
+}
+
+const char* kappa_last_error(void) {
+    return last_error.c_str();
+}
+
+kappa_workspace* kappa_workspace_create(void) {
+    return new (std::nothrow) kappa_workspace();
+}
+
+void kappa_workspace_destroy(kappa_workspace* ws) {
+    delete ws;
+}
+
+kappa_status kappa_cid(kappa_workspace* ws, const uint8_t* data, int64_t length,
+                       const kappa_options* options, kappa_stats* out) {
+    return guarded([&]() {
+        require(ws && data && out, "Null argument");
+        require(length > 0 && length <= INT_MAX, "Length must be in [1, 2^31)");
+        *out = to_c(compute_cid(data, static_cast<int>(length), ws->ws, cid_options(options)));
+    });
+}
+
+kappa_status kappa_cid_batch(const uint8_t* data, const int64_t* offsets, int64_t n_rows,
+                             int32_t n_threads, const kappa_options* options,
+                             kappa_stats* out, double* seconds) {
+    return guarded([&]() {
+        require(data && offsets && out && n_rows >= 0, "Null argument or negative row count");
+        std::vector<long long> row_offsets(offsets, offsets + n_rows + 1);
+        for (int64_t r = 0; r < n_rows; r++) {
+            require(offsets[r + 1] >= offsets[r], "Row offsets must not decrease");
+        }
+        auto rows = compute_cid_batch(data, row_offsets, n_threads, cid_options(options));
+        for (int64_t r = 0; r < n_rows; r++) {
+            out[r] = to_c(rows[r].stats);
+            if (seconds) {
+                seconds[r] = rows[r].seconds;
+            }
+        }
+    });
+}
+
+kappa_status kappa_baselines(const uint8_t* data, int64_t length, const char* null_model,
+                             int32_t n_shuffles, uint64_t seed, int32_t n_threads,
+                             const kappa_options* options, kappa_stats* out) {
+    return guarded([&]() {
+        require(data && null_model && out, "Null argument");
+        require(length > 0 && length <= INT_MAX, "Length must be in [1, 2^31)");
+        require(n_shuffles >= 0, "Negative shuffle count");
+        NullModelSpec spec;
+        try {
+            spec = parse_null_model(null_model);
+        } catch (const std::exception& e) {
+            throw std::invalid_argument(e.what());
+        }
+        auto baselines = compute_baselines(data, static_cast<int>(length), {spec}, n_shuffles,
+                                           seed, n_threads, cid_options(options));
+        for (size_t k = 0; k < baselines.size(); k++) {
+            out[k] = to_c(baselines[k].stats);
+        }
+    });
+}
+
+kappa_status kappa_read_xyz(const char* filename, kappa_particle** particles,
+                            int64_t* count) {
+    if (!filename || !particles || !count) {
+        last_error = "Null argument";
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    }
+    std::vector<Particle> read;
+    kappa_status status = guarded([&]() { read = read_xyz(filename); });
+    if (status == KAPPA_ERROR_INVALID_ARGUMENT) {
+        return KAPPA_ERROR_IO;   // unreadable or malformed file
+    }
+    return status == KAPPA_OK ? copy_particles(read, particles, count) : status;
+}
+
+kappa_status kappa_read_lammps_data(const char* filename, kappa_particle** particles,
+                                    int64_t* count, double* box_size) {
+    if (!filename || !particles || !count) {
+        last_error = "Null argument";
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    }
+    std::vector<Particle> read;
+    kappa_status status = guarded([&]() { read = read_lammps_data(filename, box_size); });
+    if (status == KAPPA_ERROR_INVALID_ARGUMENT) {
+        return KAPPA_ERROR_IO;   // unreadable or malformed file
+    }
+    return status == KAPPA_OK ? copy_particles(read, particles, count) : status;
+}
+
+void kappa_free(void* p) {
+    std::free(p);
+}
+
+kappa_status kappa_bin_particles(const kappa_particle* particles, int64_t count, int32_t nbins,
+                                 double box_size, int32_t one_symbol_per_cell, uint8_t* out,
+                                 int64_t capacity, int64_t* length) {
+    return guarded_output(out, capacity, length, [&]() {
+        require((particles || count == 0) && count >= 0, "Null argument");
+        require_grid(nbins, box_size);
+        return bin_particles(to_particles(particles, count), nbins, box_size,
+                             cached_hilbert_order(nbins), one_symbol_per_cell);
+    });
+}
+
+kappa_status kappa_hilbert_sort(const kappa_particle* particles, int64_t count, int32_t level,
+                                double box_size, int32_t n_threads, kappa_particle* sorted,
+                                uint64_t* keys, int64_t* permutation, int64_t* inside) {
+    return guarded([&]() {
+        require((particles || count == 0) && count >= 0, "Null argument");
+        SortedParticles result = hilbert_sort(to_particles(particles, count), box_size, level,
+                                              n_threads);
+        for (size_t i = 0; i < result.size(); i++) {
+            if (sorted) {
+                sorted[i] = {result.type[i], result.x[i], result.y[i], result.z[i]};
+            }
+            if (keys) {
+                keys[i] = result.keys[i];
+            }
+            if (permutation) {
+                permutation[i] = result.permutation[i];
+            }
+        }
+        if (inside) {
+            *inside = result.inside;
+        }
+    });
+}
+
+kappa_status kappa_bin_sorted(const uint64_t* keys, int64_t count, int32_t level, int32_t nbins,
+                              int32_t one_symbol_per_cell, uint8_t* out, int64_t capacity,
+                              int64_t* length) {
+    return guarded_output(out, capacity, length, [&]() {
+        require((keys || count == 0) && count >= 0, "Null argument");
+        require(level >= 1 && level <= MAX_HILBERT_LEVEL, "Hilbert level must be in [1, 21]");
+        return bin_sorted(keys, count, level, nbins, one_symbol_per_cell);
+    });
+}
+
+kappa_status kappa_type_sequence(const kappa_particle* particles, int64_t count, int32_t level,
+                                 double box_size, int32_t n_threads, uint8_t* out,
+                                 int64_t capacity, int64_t* length) {
+    return guarded_output(out, capacity, length, [&]() {
+        require((particles || count == 0) && count >= 0, "Null argument");
+        return type_sequence(hilbert_sort(to_particles(particles, count), box_size, level,
+                                          n_threads));
+    });
+}
+
+kappa_status kappa_key_gaps(const kappa_particle* particles, int64_t count, int32_t level,
+                            double box_size, int32_t quantize_bits, int32_t n_threads,
+                            uint8_t* out, int64_t capacity, int64_t* length) {
+    return guarded_output(out, capacity, length, [&]() {
+        require((particles || count == 0) && count >= 0, "Null argument");
+        return key_gap_stream(hilbert_sort(to_particles(particles, count), box_size, level,
+                                           n_threads),
+                              quantize_bits);
+    });
+}
+
+kappa_status kappa_composition_cells(const kappa_particle* particles, int64_t count,
+                                     int32_t nbins, double box_size, int32_t n_threads,
+                                     uint8_t* out, int64_t capacity, int64_t* length,
+                                     int32_t* symbol_bytes, uint32_t* dictionary,
+                                     int64_t dictionary_capacity, int32_t* n_compositions,
+                                     int32_t* types, int32_t types_capacity, int32_t* n_types) {
+    bool too_small = false;
+    kappa_status status = guarded([&]() {
+        require((particles || count == 0) && count >= 0 && out && length && symbol_bytes &&
+                    n_compositions && n_types,
+                "Null argument");
+        require_grid(nbins, box_size);
+        int level = 0;
+        while ((1 << level) < nbins) {
+            level++;
+        }
+        CompositionCells cells = composition_cells(
+            hilbert_sort(to_particles(particles, count), box_size, level, n_threads), nbins);
+        std::string encoded = cells.encode();
+        *length = encoded.size();
+        *symbol_bytes = cells.symbol_bytes();
+        *n_compositions = cells.size();
+        *n_types = cells.types.size();
+        too_small = static_cast<int64_t>(encoded.size()) > capacity ||
+                    (dictionary &&
+                     static_cast<int64_t>(cells.compositions.size()) > dictionary_capacity) ||
+                    (types && static_cast<int32_t>(cells.types.size()) > types_capacity);
+        if (too_small) {
+            return;
+        }
+        std::memcpy(out, encoded.data(), encoded.size());
+        if (dictionary) {
+            std::copy(cells.compositions.begin(), cells.compositions.end(), dictionary);
+        }
+        if (types) {
+            std::copy(cells.types.begin(), cells.types.end(), types);
+        }
+    });
+    if (status == KAPPA_OK && too_small) {
+        last_error = "Output buffer too small";
+        return KAPPA_ERROR_BUFFER_TOO_SMALL;
+    }
+    return status;
+}
+
+kappa_pool* kappa_pool_create(int32_t n_threads, int32_t max_in_flight) {
+    try {
+        return new kappa_pool(n_threads, max_in_flight);
+    } catch (const std::exception& e) {
+        last_error = e.what();
+        return nullptr;
+    }
+}
+
+void kappa_pool_close(kappa_pool* pool) {
+    if (pool) {
+        pool->jobs.close();
+    }
+}
+
+void kappa_pool_destroy(kappa_pool* pool) {
+    delete pool;
+}
+
+kappa_status kappa_pool_submit(kappa_pool* pool, const char* filename, const kappa_job* job,
+                               int64_t* id) {
+    if (!filename) {
+        last_error = "Null argument";
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    }
+    JobInput input;
+    input.filename = filename;
+    return submit_job(pool, input, job, id);
+}
+
+kappa_status kappa_pool_submit_data(kappa_pool* pool, const uint8_t* data, int64_t length,
+                                    const kappa_job* job, int64_t* id) {
+    if (!data || (job && job->input != KAPPA_INPUT_SYMBOLS)) {
+        last_error = data ? "Buffers must hold symbols" : "Null argument";
+        return KAPPA_ERROR_INVALID_ARGUMENT;
+    }
+    JobInput input;
+    input.data = data;
+    input.length = length;
+    return submit_job(pool, input, job, id);
+}
+
+int32_t kappa_pool_wait(kappa_pool* pool, double timeout, kappa_result* out) {
+    if (!pool || !out) {
+        return 0;
+    }
+    long long id = pool->jobs.wait(timeout);
+    if (id == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    auto it = pool->results.find(id);
+    *out = it->second;
+    pool->results.erase(it);
+    return 1;
+}
+
+kappa_status kappa_trace_start(const char* filename) {
+    return guarded([&]() {
+        require(filename && *filename, "Null or empty file name");
+        trace_start(filename);
+    });
+}
+
+kappa_status kappa_trace_write(const char* filename) {
+    return guarded([&]() {
+        require(filename && *filename, "Null or empty file name");
+        try {
+            trace_write(filename);
+        } catch (const std::runtime_error& e) {
+            throw io_error(e.what());
+        }
+    });
+}
+
+}  // extern "C"
@@ -0,0 +1,235 @@
+/* kappa.h - C API of libkappa, the CID engine as a shared library
+ * The suffix-array CID engine, batch and shuffle executors, particle
+ * readers, Hilbert binning and a worker pool for whole file pipelines,
+ * callable in-process from C, C++ tools, simulation plugins and Python
+ * (ctypes). The API is plain C: workspaces are opaque handles, inputs are
+ * caller-owned buffers, results are written to caller-owned structs, and
+ * every call returns a kappa_status; no C++ exception crosses the boundary.
+ * kappa_last_error() describes the last failure on the calling thread.
+ *
+ * Compatibility: functions are only ever added. A struct layout or
+ * signature change bumps KAPPA_ABI_VERSION (and the library soname).
+ */
+
+#ifndef KAPPA_H
+#define KAPPA_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KAPPA_ABI_VERSION 1
+
+/* The library is built with hidden visibility; only these are exported */
+#if defined(__GNUC__)
+#define KAPPA_API __attribute__((visibility("default")))
+#else
+#define KAPPA_API
+#endif
+
+typedef enum {
+    KAPPA_OK = 0,
+    KAPPA_ERROR_INVALID_ARGUMENT = 1,
+    KAPPA_ERROR_IO = 2,
+    KAPPA_ERROR_OUT_OF_MEMORY = 3,
+    KAPPA_ERROR_BUFFER_TOO_SMALL = 4,
+    KAPPA_ERROR_INTERNAL = 5
+} kappa_status;
+
+typedef enum {
+    KAPPA_COST_KKP = 0,
+    KAPPA_COST_GAMMA = 1,
+    KAPPA_COST_DELTA = 2,
+    KAPPA_COST_FIXED = 3
+} kappa_cost;
+
+/* Parse variant and cost model; a NULL kappa_options* means the defaults
+ * (non-overlapping sources, KKP estimate), as in lz_entropy. */
+typedef struct {
+    int32_t overlap;   /* nonzero: sources may run into the phrase */
+    int32_t cost;      /* kappa_cost */
+} kappa_options;
+
+typedef struct {
+    int64_t length;
+    int64_t factors;
+    double compressed_bits;
+    double cid;
+} kappa_stats;
+
+typedef struct {
+    int32_t type;
+    double x, y, z;
+} kappa_particle;
+
+/* Suffix-array buffers kept between calls, one per thread */
+typedef struct kappa_workspace kappa_workspace;
+
+KAPPA_API int kappa_abi_version(void);
+
+/* Message of the last failed call on this thread, "" if none */
+KAPPA_API const char* kappa_last_error(void);
+
+KAPPA_API kappa_workspace* kappa_workspace_create(void);
+KAPPA_API void kappa_workspace_destroy(kappa_workspace* ws);
+
+/* CID of data[0..length) */
+KAPPA_API kappa_status kappa_cid(kappa_workspace* ws, const uint8_t* data, int64_t length,
+                                 const kappa_options* options, kappa_stats* out);
+
+/* CID of every row data[offsets[r] .. offsets[r + 1]), r < n_rows, on
+ * n_threads threads (0 = all cores). out has n_rows entries; seconds
+ * (optional) receives the time spent on each row. */
+KAPPA_API kappa_status kappa_cid_batch(const uint8_t* data, const int64_t* offsets,
+                                       int64_t n_rows, int32_t n_threads,
+                                       const kappa_options* options, kappa_stats* out,
+                                       double* seconds);
+
+/* CID of n_shuffles randomized copies under null_model ("perm", "block:K"
+ * or "density:K"); out has n_shuffles entries, in replicate order */
+KAPPA_API kappa_status kappa_baselines(const uint8_t* data, int64_t length,
+                                       const char* null_model, int32_t n_shuffles,
+                                       uint64_t seed, int32_t n_threads,
+                                       const kappa_options* options, kappa_stats* out);
+
+/* Readers: *particles is allocated by the library, release it with
+ * kappa_free. box_size (optional) receives xhi - xlo of a LAMMPS file. */
+KAPPA_API kappa_status kappa_read_xyz(const char* filename, kappa_particle** particles,
+                                      int64_t* count);
+KAPPA_API kappa_status kappa_read_lammps_data(const char* filename,
+                                              kappa_particle** particles, int64_t* count,
+                                              double* box_size);
+KAPPA_API void kappa_free(void* p);
+
+/* Hilbert-ordered particle counts of the nbins^3 cells of [0, box_size]^3,
+ * as lz_entropy input (decimal counts, or one symbol '0' + count per cell).
+ * *length receives the encoded length; if it exceeds capacity nothing is
+ * written and KAPPA_ERROR_BUFFER_TOO_SMALL is returned. nbins^3 bytes
+ * always suffice with one_symbol_per_cell. */
+KAPPA_API kappa_status kappa_bin_particles(const kappa_particle* particles, int64_t count,
+                                           int32_t nbins, double box_size,
+                                           int32_t one_symbol_per_cell, uint8_t* out,
+                                           int64_t capacity, int64_t* length);
+
+/* Particles sorted along the Hilbert curve of the 2^level grid over
+ * [0, box_size]^3 (1 <= level <= 21), on n_threads threads (0 = all
+ * cores). sorted receives the particles in curve order, keys their
+ * ascending Hilbert keys (particles outside the box come last, with key
+ * 2^(3 level)) and permutation the input index of each; any of the three
+ * may be NULL. *inside (optional) receives the number of particles in the
+ * box. */
+KAPPA_API kappa_status kappa_hilbert_sort(const kappa_particle* particles, int64_t count,
+                                          int32_t level, double box_size, int32_t n_threads,
+                                          kappa_particle* sorted, uint64_t* keys,
+                                          int64_t* permutation, int64_t* inside);
+
+/* kappa_bin_particles from the keys of kappa_hilbert_sort at any power of
+ * two nbins <= 2^level, in one pass over the keys */
+KAPPA_API kappa_status kappa_bin_sorted(const uint64_t* keys, int64_t count, int32_t level,
+                                        int32_t nbins, int32_t one_symbol_per_cell,
+                                        uint8_t* out, int64_t capacity, int64_t* length);
+
+/* Types of the particles in [0, box_size]^3, in the order of
+ * kappa_hilbert_sort, one symbol per particle ('0' + rank of the type among
+ * the types present); count bytes always suffice. Feed it to kappa_cid
+ * and kappa_baselines for the grid-free compositional CID. */
+KAPPA_API kappa_status kappa_type_sequence(const kappa_particle* particles, int64_t count,
+                                           int32_t level, double box_size, int32_t n_threads,
+                                           uint8_t* out, int64_t capacity, int64_t* length);
+
+/* Gaps between the consecutive Hilbert keys of the particles in the box,
+ * shifted right by quantize_bits, as LEB128 varints (see key_gap_stream
+ * in hilbert.h); 10 * count bytes always suffice */
+KAPPA_API kappa_status kappa_key_gaps(const kappa_particle* particles, int64_t count,
+                                      int32_t level, double box_size, int32_t quantize_bits,
+                                      int32_t n_threads, uint8_t* out, int64_t capacity,
+                                      int64_t* length);
+
+/* One symbol per cell of the nbins^3 grid over [0, box_size]^3, in
+ * Hilbert order, numbering the distinct cell compositions (count of every
+ * particle type) in order of first appearance. *symbol_bytes receives 1
+ * if there are at most 256 compositions (one byte per cell), else 2 (two
+ * bytes per cell, high byte first; at most 65536); out is kappa_cid input
+ * either way. dictionary (optional) receives the *n_compositions
+ * compositions as rows of *n_types counts, for the types in ascending
+ * order written to types (optional). If out, dictionary or types is too
+ * small, nothing is written, the sizes are set and
+ * KAPPA_ERROR_BUFFER_TOO_SMALL is returned. */
+KAPPA_API kappa_status kappa_composition_cells(const kappa_particle* particles, int64_t count,
+                                               int32_t nbins, double box_size,
+                                               int32_t n_threads, uint8_t* out,
+                                               int64_t capacity, int64_t* length,
+                                               int32_t* symbol_bytes, uint32_t* dictionary,
+                                               int64_t dictionary_capacity,
+                                               int32_t* n_compositions, int32_t* types,
+                                               int32_t types_capacity, int32_t* n_types);
+
+/* Worker pool: files or buffers are submitted one at a time and processed
+ * (read, binned, parsed, shuffled) on the pool's threads while the caller
+ * goes on; results come back through kappa_pool_wait in completion order.
+ * At most max_in_flight jobs are submitted and not yet collected; submit
+ * blocks beyond that. */
+typedef struct kappa_pool kappa_pool;
+
+typedef enum {
+    KAPPA_INPUT_SYMBOLS = 0,   /* file or buffer is the symbol string */
+    KAPPA_INPUT_XYZ = 1,       /* xyz snapshot, binned on the grid */
+    KAPPA_INPUT_LAMMPS = 2     /* LAMMPS data file, binned on the grid */
+} kappa_input;
+
+typedef struct {
+    int32_t input;                 /* kappa_input */
+    int32_t nbins;                 /* particle inputs: cells per box edge */
+    double box_size;               /* particle inputs; 0: LAMMPS box, else required */
+    int32_t one_symbol_per_cell;
+    int32_t n_shuffles;            /* "perm" baselines, 0 for the CID only */
+    uint64_t seed;
+    kappa_options options;
+} kappa_job;
+
+typedef struct {
+    int64_t id;                    /* as returned by kappa_pool_submit* */
+    int32_t status;                /* kappa_status of the job */
+    kappa_stats stats;
+    double cid_shuffled;           /* mean baseline CID, 0 without shuffles */
+    double cid_shuffled_std;
+    double seconds;                /* wall time of the job on its worker */
+    char error[256];               /* message if status != KAPPA_OK */
+} kappa_result;
+
+/* n_threads workers (0 = all cores); max_in_flight <= 0: two per worker */
+KAPPA_API kappa_pool* kappa_pool_create(int32_t n_threads, int32_t max_in_flight);
+
+/* close drops the queued jobs and wakes blocked callers; destroy also
+ * waits for the running jobs */
+KAPPA_API void kappa_pool_close(kappa_pool* pool);
+KAPPA_API void kappa_pool_destroy(kappa_pool* pool);
+
+/* Queue a job on a file, or on data[0..length) which the caller keeps
+ * alive and unchanged until its result is collected; *id receives the job
+ * id. Both fail once the pool is closed. */
+KAPPA_API kappa_status kappa_pool_submit(kappa_pool* pool, const char* filename,
+                                         const kappa_job* job, int64_t* id);
+KAPPA_API kappa_status kappa_pool_submit_data(kappa_pool* pool, const uint8_t* data,
+                                              int64_t length, const kappa_job* job,
+                                              int64_t* id);
+
+/* Result of the next finished job, waiting up to timeout seconds (< 0: until
+ * one finishes or the pool is closed). Returns 1 with *out filled, 0 on
+ * timeout or once the pool is closed. */
+KAPPA_API int32_t kappa_pool_wait(kappa_pool* pool, double timeout, kappa_result* out);
+
+/* Timeline of the read, bin, cid and shuffle tasks of every thread as
+ * Chrome trace JSON (open in Perfetto). start turns recording on, and the
+ * trace is written to filename at exit; write saves the events recorded
+ * so far, and must not run while jobs or batch calls are in progress. */
+KAPPA_API kappa_status kappa_trace_start(const char* filename);
+KAPPA_API kappa_status kappa_trace_write(const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KAPPA_H */
@@ -0,0 +1,360 @@
+// lz77.cpp - LZ77 factorization engine
+// Uses divsufsort for suffix array construction
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "dispatch.h"
+#include "lz77.h"
+#include "profile.h"
+
+extern "C" {
+    #include "divsufsort.h"
+}
+
+void build_suffix_array(const unsigned char* text, int length, Workspace& ws) {
+    PROFILE_PHASE("sa");
+    ws.sa.resize(length);
+    if (divsufsort(text, ws.sa.data(), length) != 0) {
+        throw std::runtime_error("Suffix array construction failed");
+    }
+}
+
+// Build LCP (Longest Common Prefix) array from suffix array
+HOT_KERNEL void build_lcp(const unsigned char* text, int length, Workspace& ws) {
+    PROFILE_PHASE("lcp");
+    const int* sa = ws.sa.data();
+    ws.lcp.assign(length, 0);
+    ws.rank.resize(length);
+    int* lcp = ws.lcp.data();
+    int* rank = ws.rank.data();
+    
+    for (int i = 0; i < length; i++) {
+        rank[sa[i]] = i;
+    }
+    
+    int h = 0;
+    for (int i = 0; i < length; i++) {
+        if (rank[i] > 0) {
+            int j = sa[rank[i] - 1];
+            while (i + h < length && j + h < length && text[i + h] == text[j + h]) {
+                h++;
+            }
+            lcp[rank[i]] = h;
+            if (h > 0) h--;
+        }
+    }
+}
+
+// KKP3 style: sweep the suffix array keeping the chain of PSV links from the
+// previous suffix; the chain is the stack, so no extra buffer is needed.
+// LCP(i, psv[i]) >= LCP(i-1, psv[i-1]) - 1 (psv[i-1] + 1 is a candidate for
+// psv[i]), likewise for nsv, so both LCP arrays are filled Kasai-style with
+// O(n) character comparisons in total.
+HOT_KERNEL void build_psv_nsv(const unsigned char* text, int length, Workspace& ws) {
+    PROFILE_PHASE("psv_nsv");
+    const int* sa = ws.sa.data();
+    ws.psv.resize(length);
+    ws.nsv.resize(length);
+    ws.psv_lcp.resize(length);
+    ws.nsv_lcp.resize(length);
+    int* psv = ws.psv.data();
+    int* nsv = ws.nsv.data();
+    
+    int top = -1;
+    for (int r = 0; r < length; r++) {
+        int pos = sa[r];
+        while (top > pos) {
+            nsv[top] = pos;
+            top = psv[top];
+        }
+        psv[pos] = top;
+        top = pos;
+    }
+    while (top >= 0) {
+        nsv[top] = -1;
+        top = psv[top];
+    }
+    
+    const int* links[2] = {psv, nsv};
+    int* lcps[2] = {ws.psv_lcp.data(), ws.nsv_lcp.data()};
+    for (int side = 0; side < 2; side++) {
+        const int* link = links[side];
+        int* lcp = lcps[side];
+        int h = 0;
+        for (int i = 0; i < length; i++) {
+            int j = link[i];
+            if (j < 0) {
+                lcp[i] = 0;
+                h = 0;
+                continue;
+            }
+            // j < i, so text[j + h] is in range whenever text[i + h] is
+            while (i + h < length && text[j + h] == text[i + h]) {
+                h++;
+            }
+            lcp[i] = h;
+            if (h > 0) h--;
+        }
+    }
+}
+
+// Only the PSV and NSV of a suffix can hold its longest previous factor:
+// any other earlier suffix is lexicographically farther away.
+void build_lpf(int length, Workspace& ws) {
+    ws.lpf.resize(length);
+    ws.prev_occ.resize(length);
+    for (int i = 0; i < length; i++) {
+        int p = ws.psv_lcp[i];
+        int n = ws.nsv_lcp[i];
+        if (p == 0 && n == 0) {
+            ws.lpf[i] = 0;
+            ws.prev_occ[i] = -1;
+        } else if (p >= n) {
+            ws.lpf[i] = p;
+            ws.prev_occ[i] = ws.psv[i];
+        } else {
+            ws.lpf[i] = n;
+            ws.prev_occ[i] = ws.nsv[i];
+        }
+    }
+}
+
+void compute_lpf(const unsigned char* text, int length, Workspace& ws) {
+    build_suffix_array(text, length, ws);
+    build_psv_nsv(text, length, ws);
+    build_lpf(length, ws);
+}
+
+namespace {
+
+inline int floor_log2(unsigned long long x) {
+    return 63 - __builtin_clzll(x);
+}
+
+inline int gamma_len(unsigned long long x) {
+    return 2 * floor_log2(x) + 1;
+}
+
+inline int delta_len(unsigned long long x) {
+    int n = floor_log2(x);
+    return n + 2 * floor_log2(n + 1) + 1;
+}
+
+// Longest match for position i whose source lies entirely in text[0..i).
+// Walk the PSV (or NSV) chain: every suffix skipped by the chain is both
+// lexicographically farther and closer in the text than a chain member, so
+// it cannot do better. Along the chain the LCP shrinks and the distance
+// d = i - j grows; the candidate is worth min(LCP, d), so the walk stops at
+// the first member with LCP <= d. All earlier members have d below the best
+// value found, so the walk costs O(phrase length).
+inline void non_overlapping_match(int i, const int* link, const int* link_lcp,
+                                  int& best_len, int& best_src) {
+    int j = link[i];
+    int h = link_lcp[i];
+    while (j >= 0 && h > 0) {
+        int d = i - j;
+        if (h <= d) {
+            if (h > best_len) {
+                best_len = h;
+                best_src = j;
+            }
+            break;
+        }
+        if (d > best_len) {
+            best_len = d;
+            best_src = j;
+        }
+        h = std::min(h, link_lcp[j]);
+        j = link[j];
+    }
+}
+
+}  // namespace
+
+void add_phrase(ParseStats& stats, long long len, long long offset, int fixed_len) {
+    stats.factors++;
+    if (len == 0) {
+        // Literal: code(1) then the 8-bit symbol
+        stats.gamma_bits += 1 + 8;
+        stats.delta_bits += 1 + 8;
+    } else {
+        stats.gamma_bits += gamma_len(len + 1) + gamma_len(offset);
+        stats.delta_bits += delta_len(len + 1) + delta_len(offset);
+    }
+    stats.fixed_bits += fixed_len;
+}
+
+int fixed_phrase_bits(long long max_value) {
+    int width = floor_log2(static_cast<unsigned long long>(max_value)) + 1;
+    return std::max(width, 8) + width;
+}
+
+namespace {
+
+// A parse of the prefix text[0..prefix): only the fixed-width cost depends
+// on the length, through the field width
+ParseResult prefix_snapshot(ParseResult result, int prefix) {
+    int fixed_len = prefix > 0 ? fixed_phrase_bits(prefix) : 0;
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        result.variant[v].fixed_bits = result.variant[v].factors * fixed_len;
+    }
+    return result;
+}
+
+// Greedy parse of text[start..length); sources may start anywhere before
+// each phrase, including text[0..start)
+ParseResult factorize(int start, int length, const Workspace& ws,
+                      const std::vector<int>* checkpoints,
+                      std::vector<ParseResult>* snapshots) {
+    PROFILE_PHASE("factorize");
+    const int* psv = ws.psv.data();
+    const int* nsv = ws.nsv.data();
+    const int* psv_lcp = ws.psv_lcp.data();
+    const int* nsv_lcp = ws.nsv_lcp.data();
+    
+    int fixed_len = fixed_phrase_bits(length);
+    
+    ParseResult result = {};
+    int next[NUM_VARIANTS] = {start, start};  // start of the next phrase of each variant
+    size_t next_cp = 0;
+    
+    if (checkpoints) {
+        snapshots->assign(checkpoints->size(), ParseResult());
+    }
+    
+    while (true) {
+        int i = std::min(next[NON_OVERLAPPING], next[OVERLAPPING]);
+        
+        // Phrases of either variant that start before a checkpoint have all
+        // been added once both cursors are past it
+        while (checkpoints && next_cp < checkpoints->size() &&
+               (*checkpoints)[next_cp] <= i) {
+            (*snapshots)[next_cp] = prefix_snapshot(result, (*checkpoints)[next_cp]);
+            next_cp++;
+        }
+        if (i >= length) {
+            break;
+        }
+        
+        if (next[NON_OVERLAPPING] == i) {
+            int len = 0;
+            int src = -1;
+            non_overlapping_match(i, psv, psv_lcp, len, src);
+            non_overlapping_match(i, nsv, nsv_lcp, len, src);
+            add_phrase(result.variant[NON_OVERLAPPING], len, i - src, fixed_len);
+            next[NON_OVERLAPPING] = i + std::max(len, 1);
+        }
+        
+        if (next[OVERLAPPING] == i) {
+            int len = std::max(psv_lcp[i], nsv_lcp[i]);
+            int src = psv_lcp[i] >= nsv_lcp[i] ? psv[i] : nsv[i];
+            add_phrase(result.variant[OVERLAPPING], len, i - src, fixed_len);
+            next[OVERLAPPING] = i + std::max(len, 1);
+        }
+    }
+    
+    while (checkpoints && next_cp < checkpoints->size()) {
+        (*snapshots)[next_cp] = prefix_snapshot(result, (*checkpoints)[next_cp]);
+        next_cp++;
+    }
+    
+    return result;
+}
+
+}  // namespace
+
+ParseResult lz77_factorize(int length, const Workspace& ws,
+                           const std::vector<int>* checkpoints,
+                           std::vector<ParseResult>* snapshots) {
+    return factorize(0, length, ws, checkpoints, snapshots);
+}
+
+ParseResult lz77_factorize_from(int start, int length, const Workspace& ws) {
+    return factorize(start, length, ws, nullptr, nullptr);
+}
+
+double kkp_bits(long long num_factors, long long length) {
+    if (num_factors > 0 && num_factors < length) {
+        return num_factors * std::log2(num_factors) + 
+               2.0 * num_factors * std::log2(static_cast<double>(length) / num_factors);
+    }
+    // Fallback for edge cases
+    return length * 8.0;  // Incompressible
+}
+
+CompressionStats make_stats(const ParseResult& parse, long long length,
+                            const CidOptions& options) {
+    const ParseStats& p = parse.variant[options.variant];
+    CompressionStats stats;
+    stats.length = length;
+    stats.factors = p.factors;
+    switch (options.cost) {
+        case COST_GAMMA: stats.compressed_bits = p.gamma_bits; break;
+        case COST_DELTA: stats.compressed_bits = p.delta_bits; break;
+        case COST_FIXED: stats.compressed_bits = p.fixed_bits; break;
+        default: stats.compressed_bits = kkp_bits(p.factors, length); break;
+    }
+    stats.cid = stats.compressed_bits / (length * 8.0);
+    stats.parse = parse;
+    return stats;
+}
+
+std::vector<int> geometric_checkpoints(int length, int min_prefix, double ratio) {
+    if (min_prefix < 1 || ratio <= 1.0) {
+        throw std::runtime_error("Checkpoints need min prefix >= 1 and ratio > 1");
+    }
+    std::vector<int> checkpoints;
+    double p = min_prefix;
+    while (p < length) {
+        int cp = static_cast<int>(p);
+        if (checkpoints.empty() || cp > checkpoints.back()) {
+            checkpoints.push_back(cp);
+        }
+        p *= ratio;
+    }
+    checkpoints.push_back(length);
+    return checkpoints;
+}
+
+CompressionStats compute_cid(const unsigned char* text, int length, Workspace& ws,
+                             const CidOptions& options,
+                             std::vector<CompressionStats>* curve) {
+    if (length <= 0) {
+        throw std::runtime_error("Empty input");
+    }
+    
+    // Build suffix array and its smaller-value arrays
+    build_suffix_array(text, length, ws);
+    build_psv_nsv(text, length, ws);
+    
+    // Compute LZ77 factorization
+    if (curve) {
+        std::vector<int> checkpoints = geometric_checkpoints(length, options.min_prefix,
+                                                             options.ratio);
+        std::vector<ParseResult> snapshots;
+        ParseResult parse = lz77_factorize(length, ws, &checkpoints, &snapshots);
+        curve->clear();
+        for (size_t k = 0; k < checkpoints.size(); k++) {
+            curve->push_back(make_stats(snapshots[k], checkpoints[k], options));
+        }
+        return make_stats(parse, length, options);
+    }
+    
+    return make_stats(lz77_factorize(length, ws), length, options);
+}
+
+CompressionStats compute_cid(const std::string& data, Workspace& ws,
+                             const CidOptions& options,
+                             std::vector<CompressionStats>* curve) {
+    return compute_cid(reinterpret_cast<const unsigned char*>(data.c_str()),
+                       static_cast<int>(data.length()), ws, options, curve);
+}
+
+CompressionStats compute_cid(const std::string& data,
+                             const CidOptions& options,
+                             std::vector<CompressionStats>* curve) {
+    Workspace ws;
+    return compute_cid(data, ws, options, curve);
+}
@@ -0,0 +1,144 @@
+// lz77.h - LZ77 factorization engine behind lz_entropy
+// Suffix array (divsufsort), LCP, longest-previous-factor and CID routines
+
+#ifndef LZ77_H
+#define LZ77_H
+
+#include <string>
+#include <vector>
+
+#include "hugepage.h"
+
+// Engine array; large ones may be huge-page backed (see hugepage.h)
+using IntBuffer = std::vector<int, BufferAllocator<int>>;
+
+// Buffers for the suffix structures of one input. They are resized, never
+// shrunk, so a workspace kept per thread serves a whole batch of inputs
+// without reallocating.
+struct Workspace {
+    IntBuffer sa;        // suffix array
+    IntBuffer rank;      // inverse suffix array (build_lcp only)
+    IntBuffer lcp;       // lcp[r] = LCP(sa[r-1], sa[r]), lcp[0] = 0
+    IntBuffer psv;       // see build_psv_nsv, indexed by text position
+    IntBuffer nsv;
+    IntBuffer psv_lcp;   // LCP(i, psv[i]), 0 if psv[i] == -1
+    IntBuffer nsv_lcp;   // LCP(i, nsv[i]), 0 if nsv[i] == -1
+    IntBuffer lpf;       // longest previous factor per text position
+    IntBuffer prev_occ;  // start of an earlier occurrence, -1 if lpf == 0
+};
+
+// LZ77 parse variants; both are computed in the same pass
+enum ParseVariant {
+    NON_OVERLAPPING = 0,  // source ends before the phrase starts (default)
+    OVERLAPPING = 1,      // source may run into the phrase (standard LZ77)
+    NUM_VARIANTS = 2
+};
+
+// Encoding used for the compressed size
+enum CostModel {
+    COST_KKP,    // z log2 z + 2 z log2(n / z) estimate from the phrase count
+    COST_GAMMA,  // Elias-gamma coded (offset, len) pairs
+    COST_DELTA,  // Elias-delta coded (offset, len) pairs
+    COST_FIXED   // fixed-width (offset, len) pairs
+};
+
+// Phrase count and exact size of one parse. Every phrase is written as
+// code(len + 1) followed by code(offset) for a match or the 8-bit symbol for
+// a literal; fixed width uses ceil(log2(n + 1)) bits per field (at least 8
+// for the offset/symbol field).
+struct ParseStats {
+    long long factors;
+    long long gamma_bits;
+    long long delta_bits;
+    long long fixed_bits;
+};
+
+struct ParseResult {
+    ParseStats variant[NUM_VARIANTS];
+};
+
+struct CompressionStats {
+    long long length;
+    long long factors;
+    double compressed_bits;
+    double cid;
+    ParseResult parse;
+};
+
+struct CidOptions {
+    ParseVariant variant = NON_OVERLAPPING;
+    CostModel cost = COST_KKP;
+    int min_prefix = 16;   // curve only
+    double ratio = 2.0;    // curve only
+};
+
+// Build suffix array of text into ws.sa
+void build_suffix_array(const unsigned char* text, int length, Workspace& ws);
+
+// Build LCP (Longest Common Prefix) array from ws.sa into ws.lcp
+void build_lcp(const unsigned char* text, int length, Workspace& ws);
+
+// Previous/next smaller values of ws.sa, indexed by text position: psv[i]
+// (nsv[i]) is the start of the lexicographically closest suffix before
+// (after) suffix i that starts earlier in the text, -1 if none. Also fills
+// psv_lcp and nsv_lcp. Linear time, no LCP array needed.
+// ws.sa may also be the suffix array of a longer text that starts with this
+// one, restricted to positions < length: the factorizer only uses LCPs with
+// earlier positions, which are capped at length either way.
+void build_psv_nsv(const unsigned char* text, int length, Workspace& ws);
+
+// Build LPF and previous-occurrence arrays from the PSV/NSV arrays.
+// lpf[i] is the length of the longest prefix of text[i..] that starts at
+// some j < i (the occurrence may overlap i), prev_occ[i] is such a j.
+void build_lpf(int length, Workspace& ws);
+
+// Suffix array, PSV/NSV and LPF of text in one call
+void compute_lpf(const unsigned char* text, int length, Workspace& ws);
+
+// Greedy LZ77 factorization of both variants in one left-to-right pass over
+// the PSV/NSV arrays in ws, linear time.
+// If checkpoints (ascending prefix lengths) is given, snapshots[k] receives
+// the parse of the prefix checkpoints[k], counting the phrases that start
+// before it. The greedy parse of a prefix is the truncation of the full
+// parse, so the whole curve comes out of the same pass.
+ParseResult lz77_factorize(int length, const Workspace& ws,
+                           const std::vector<int>* checkpoints = nullptr,
+                           std::vector<ParseResult>* snapshots = nullptr);
+
+// Add one phrase at offset (distance back to its source) to stats; len == 0
+// is a literal. fixed_len is the fixed-width cost of a phrase, see
+// fixed_phrase_bits.
+void add_phrase(ParseStats& stats, long long len, long long offset, int fixed_len);
+
+// Fixed-width phrase cost when offsets and lengths are at most max_value
+int fixed_phrase_bits(long long max_value);
+
+// Greedy parse of text[start..length) only, with text[0..start) available
+// as a reference for sources (relative or conditional compression)
+ParseResult lz77_factorize_from(int start, int length, const Workspace& ws);
+
+// Compressed size of a parse with num_factors phrases (KKP approximation)
+double kkp_bits(long long num_factors, long long length);
+
+// Stats of the variant and cost model selected in options
+CompressionStats make_stats(const ParseResult& parse, long long length,
+                            const CidOptions& options = CidOptions());
+
+// Prefix lengths min_prefix, min_prefix*ratio, ... capped by (and ending at) length
+std::vector<int> geometric_checkpoints(int length, int min_prefix, double ratio);
+
+// If curve is given, it also receives the stats of every geometric prefix
+// (see geometric_checkpoints); the last entry is the whole input.
+CompressionStats compute_cid(const unsigned char* text, int length, Workspace& ws,
+                             const CidOptions& options = CidOptions(),
+                             std::vector<CompressionStats>* curve = nullptr);
+
+CompressionStats compute_cid(const std::string& data, Workspace& ws,
+                             const CidOptions& options = CidOptions(),
+                             std::vector<CompressionStats>* curve = nullptr);
+
+CompressionStats compute_cid(const std::string& data,
+                             const CidOptions& options = CidOptions(),
+                             std::vector<CompressionStats>* curve = nullptr);
+
+#endif // LZ77_H
@@ -8,126 +8,176 @@
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 
-extern "C" {
-    #include "divsufsort.h"
-}
+#include "batch.h"
+#include "budget.h"
+#include "dispatch.h"
+#include "lz77.h"
+#include "mutual.h"
+#include "online.h"
+#include "profile.h"
+#include "sampling.h"
+#include "shuffle.h"
+#include "streaming.h"
+#include "trace.h"
+#include "trajectory.h"
 
-// Build LCP (Longest Common Prefix) array from suffix array
-std::vector<int> build_lcp(const unsigned char* text, int length, const int* sa) {
-    std::vector<int> lcp(length, 0);
-    std::vector<int> rank(length);
-    
-    for (int i = 0; i < length; i++) {
-        rank[sa[i]] = i;
-    }
-    
-    int h = 0;
-    for (int i = 0; i < length; i++) {
-        if (rank[i] > 0) {
-            int j = sa[rank[i] - 1];
-            while (i + h < length && j + h < length && text[i + h] == text[j + h]) {
-                h++;
+// Value of a numeric option; the whole argument must parse and fit in T
+template <typename T>
+T parse_number(const std::string& option, const std::string& text) {
+    size_t used = 0;
+    try {
+        if constexpr (std::is_floating_point<T>::value) {
+            T value = std::stod(text, &used);
+            if (used == text.size()) {
+                return value;
+            }
+        } else if constexpr (std::is_unsigned<T>::value) {
+            // stoull would wrap a negative value around
+            unsigned long long value = std::stoull(text, &used);
+            if (used == text.size() && text.find('-') == std::string::npos &&
+                value <= std::numeric_limits<T>::max()) {
+                return static_cast<T>(value);
+            }
+        } else {
+            long long value = std::stoll(text, &used);
+            if (used == text.size() && value >= std::numeric_limits<T>::min() &&
+                value <= std::numeric_limits<T>::max()) {
+                return static_cast<T>(value);
             }
-            lcp[rank[i]] = h;
-            if (h > 0) h--;
         }
+    } catch (const std::exception&) {
     }
-    
-    return lcp;
+    throw std::runtime_error("Invalid value for " + option + ": " + text);
 }
 
-// Improved LZ77 factorization
-int lz77_factorize(const unsigned char* text, int length, const int* sa) {
-    std::vector<int> lcp = build_lcp(text, length, sa);
-    int num_factors = 0;
-    int i = 0;
-    
-    while (i < length) {
-        int max_len = 0;
-        int max_pos = -1;
-        
-        // Find longest match in text[0..i-1]
-        for (int j = 0; j < length; j++) {
-            if (sa[j] >= i) continue;  // Only look at previous positions
-            
-            int pos = sa[j];
-            int len = 0;
-            
-            // Calculate match length
-            while (pos + len < i && i + len < length && 
-                   text[pos + len] == text[i + len]) {
-                len++;
-            }
-            
-            if (len > max_len) {
-                max_len = len;
-                max_pos = pos;
-            }
-        }
-        
-        if (max_len > 0) {
-            // Found a match - this is one factor
-            i += max_len;
-        } else {
-            // No match - literal character
-            i++;
-        }
-        
-        num_factors++;
+// item numbers the file in the trace (frame index)
+std::string read_file(const std::string& filename, long long item = 0) {
+    PROFILE_PHASE("read");
+    TraceSpan span("read", item, 0);
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + filename);
     }
     
-    return num_factors;
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    span.set_size(data.length());
+    return data;
 }
 
-struct CompressionStats {
-    int length;
-    int factors;
-    double compressed_bits;
-    double cid;
-};
+// Phase table of the -v output; empty unless built with make PROFILE=1
+void print_profile(const std::vector<PhaseProfile>& phases) {
+    if (phases.empty()) {
+        return;
+    }
+    std::cout << "\nPhase\t\tcalls\tseconds\tallocated (MB)\tpeak RSS (MB)\n";
+    for (const auto& p : phases) {
+        std::cout << p.name << (p.name.size() < 8 ? "\t\t" : "\t") << p.calls << "\t"
+                  << p.seconds << "\t" << p.bytes_allocated / 1048576.0 << "\t"
+                  << p.peak_rss / 1048576.0 << "\n";
+    }
 
-CompressionStats compute_cid(const std::string& data) {
-    if (data.empty()) {
-        throw std::runtime_error("Empty input");
+    // Counters that were not read (or not permitted) print as -
+    bool any_counter = false;
+    for (const auto& p : phases) {
+        any_counter = any_counter ||
+            std::any_of(p.counters, p.counters + NUM_COUNTERS, [](long long c) { return c >= 0; });
     }
-    
-    int length = data.length();
-    const unsigned char* text = reinterpret_cast<const unsigned char*>(data.c_str());
-    
-    // Build suffix array
-    std::vector<int> sa(length);
-    if (divsufsort(text, sa.data(), length) != 0) {
-        throw std::runtime_error("Suffix array construction failed");
+    if (!any_counter) {
+        return;
     }
-    
-    // Compute LZ77 factorization
-    int num_factors = lz77_factorize(text, length, sa.data());
-    
-    // Calculate compressed size (KKP approximation)
-    double compressed_bits = 0.0;
-    if (num_factors > 0 && num_factors < length) {
-        compressed_bits = num_factors * std::log2(num_factors) + 
-                         2.0 * num_factors * std::log2(static_cast<double>(length) / num_factors);
-    } else {
-        // Fallback for edge cases
-        compressed_bits = length * 8.0;  // Incompressible
+    auto print_counter = [](long long c) {
+        std::cout << "\t";
+        if (c >= 0) {
+            std::cout << c;
+        } else {
+            std::cout << "-";
+        }
+    };
+    std::cout << "\nPhase\t";
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        std::cout << "\t" << COUNTER_NAMES[c];
+    }
+    std::cout << "\tIPC\n";
+    for (const auto& p : phases) {
+        std::cout << p.name << (p.name.size() < 8 ? "\t" : "");
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            print_counter(p.counters[c]);
+        }
+        long long cycles = p.counters[COUNTER_CYCLES];
+        long long instructions = p.counters[COUNTER_INSTRUCTIONS];
+        std::cout << "\t";
+        if (cycles > 0 && instructions >= 0) {
+            std::cout << static_cast<double>(instructions) / cycles;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << "\n";
     }
-    
-    CompressionStats stats;
-    stats.length = length;
-    stats.factors = num_factors;
-    stats.compressed_bits = compressed_bits;
-    stats.cid = compressed_bits / (length * 8.0);
-    
-    return stats;
 }
 
 void print_usage(const char* prog) {
-    std::cerr << "Usage: " << prog << " [options] <input_file>\n\n";
+    std::cerr << "Usage: " << prog << " [options] <input_file>\n";
+    std::cerr << "       " << prog << " [options] --frames W <frame_file>...\n";
+    std::cerr << "       " << prog << " [options] --mi <channel_a> <channel_b>\n\n";
     std::cerr << "Options:\n";
     std::cerr << "  -t           Tab-delimited output (length\\tfactors\\tcid)\n";
-    std::cerr << "  -v           Verbose output\n";
+    std::cerr << "  -v           Verbose output (with per-phase time and memory when built\n";
+    std::cerr << "               with make PROFILE=1)\n";
+    std::cerr << "  --json       JSON output: stats, curve, baselines and phase profile\n";
+    std::cerr << "  --trace FILE Record a timeline of the read, sort, CID and shuffle tasks of\n";
+    std::cerr << "               every thread as Chrome trace JSON (open in Perfetto)\n";
+    std::cerr << "  --counters   Also read hardware counters (cycles, instructions, branch,\n";
+    std::cerr << "               LLC and dTLB misses) per phase with perf_event_open\n";
+    std::cerr << "  --curve      Also report CID of geometric prefixes (one line each)\n";
+    std::cerr << "  --ratio R    Growth factor between curve prefixes (default 2)\n";
+    std::cerr << "  --min-prefix N  Shortest curve prefix (default 16)\n";
+    std::cerr << "  --overlap    Let a phrase copy from a source that runs into it\n";
+    std::cerr << "  --cost C     Compressed size from kkp (default), gamma, delta or fixed codes\n";
+    std::cerr << "  --lpf FILE   Write LPF then previous-occurrence arrays (int32) to FILE\n";
+    std::cerr << "  --shuffles N Also compute N shuffled baselines per null model\n";
+    std::cerr << "  --null M     Null model: perm (default), block:K (permute blocks of 2^K\n";
+    std::cerr << "               symbols) or density:K (move particles within super-cells of\n";
+    std::cerr << "               8^K cells, symbols '0' + count); may be repeated\n";
+    std::cerr << "  --seed S     Base seed of the shuffles (default 0)\n";
+    std::cerr << "  -j N         Threads for the shuffles (default: all cores)\n";
+    std::cerr << "  --frames W   CID of each window of W consecutive frames (one file per\n";
+    std::cerr << "               frame); prints first_frame\\tlength\\tfactors\\tcid per window\n";
+    std::cerr << "  --stride S   Frames between window starts (default 1)\n";
+    std::cerr << "  --sample     Estimate CID from randomly placed windows without reading\n";
+    std::cerr << "               the whole file; -t prints length\\tfactors\\tcid\\tlow\\thigh\n";
+    std::cerr << "               \\tsamples\\tsampling_low\\tsampling_high (low - high: 95%\n";
+    std::cerr << "               interval of the whole-input CID; sampling: of the choice\n";
+    std::cerr << "               of windows alone)\n";
+    std::cerr << "  --samples M  Windows to factorize (default 32)\n";
+    std::cerr << "  --sample-window W  Symbols per window (default 1048576)\n";
+    std::cerr << "  --time-budget S    Stop drawing windows after S seconds\n";
+    std::cerr << "  --window W   Bounded parse: sources at most W symbols back, phrases at most\n";
+    std::cerr << "               W long; streams the input (\"-\" for stdin) in O(W) memory\n";
+    std::cerr << "  --max-chain N  Hash-chain candidates per phrase with --window (default 0 =\n";
+    std::cerr << "               all, exact longest match)\n";
+    std::cerr << "  --online     Parse the input (\"-\" for stdin) as it arrives; prints\n";
+    std::cerr << "               length\\tfactors\\tcid of the input so far after every chunk\n";
+    std::cerr << "  --chunk N    Symbols per chunk with --online (default 65536)\n";
+    std::cerr << "  --mi         Mutual information of two equal-length channels; prints\n";
+    std::cerr << "               cid_a\\tcid_b\\tcid_joint\\tcid_b_given_a\\tmi_joint\\tmi_conditional\n";
+    std::cerr << "  --rows L     Batch: the file holds rows of L symbols; prints\n";
+    std::cerr << "               row\\tlength\\tfactors\\tcid\\tseconds per row (threads: -j)\n";
+    std::cerr << "  --row-lengths FILE  Batch with rows of the lengths in FILE (int64)\n";
+    std::cerr << "  --mem-budget SIZE  Keep the estimated peak under SIZE bytes (K, M, G\n";
+    std::cerr << "               suffixes): falls back to the windowed parse when the suffix\n";
+    std::cerr << "               array does not fit and caps -j for shuffles, --rows and\n";
+    std::cerr << "               --sample; the plan is printed to stderr, and for one\n";
+    std::cerr << "               input -t appends engine\\twindow\\tthreads\\tpeak_bytes\n";
+    std::cerr << "               and --json adds a \"plan\" object\n";
+    std::cerr << "  --huge-pages M  Page size of the large engine buffers: system (kernel\n";
+    std::cerr << "               policy, default), none, thp (madvise) or explicit (reserved\n";
+    std::cerr << "               2 MB pages, thp if none are free)\n";
     std::cerr << "  -h, --help   Show this help\n\n";
     std::cerr << "Computes LZ77-based compression entropy (CID).\n";
 }
@@ -135,55 +185,455 @@ void print_usage(const char* prog) {
 int main(int argc, char* argv[]) {
     bool tab_output = false;
     bool verbose = false;
-    std::string filename;
+    bool curve_output = false;
+    bool json_output = false;
+    CidOptions options;
+    std::string lpf_filename;
+    int n_shuffles = 0;
+    std::vector<NullModelSpec> null_models;
+    unsigned long long seed = 0;
+    int n_threads = 0;
+    int window_frames = 0;
+    int stride = 1;
+    bool sampled = false;
+    SampleOptions sample;
+    bool streaming = false;
+    StreamOptions stream;
+    bool online = false;
+    bool mutual = false;
+    long long row_length = 0;
+    std::string row_lengths_filename;
+    int chunk = 1 << 16;
+    long long mem_budget = 0;
+    std::vector<std::string> filenames;
     
-    // Parse arguments
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
-        if (arg == "-t") {
-            tab_output = true;
-        } else if (arg == "-v") {
-            verbose = true;
-        } else if (arg == "-h" || arg == "--help") {
-            print_usage(argv[0]);
-            return 0;
-        } else if (arg[0] == '-') {
-            std::cerr << "Unknown option: " << arg << "\n";
-            print_usage(argv[0]);
-            return 1;
-        } else {
-            filename = arg;
+    // Parse arguments; a malformed value ends the run like any other error
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-t") {
+                tab_output = true;
+            } else if (arg == "-v") {
+                verbose = true;
+            } else if (arg == "--json") {
+                json_output = true;
+            } else if (arg == "--trace" && i + 1 < argc) {
+                trace_start(argv[++i]);
+            } else if (arg == "--counters") {
+                if (!profile_set_counters(true)) {
+                    std::cerr << "Warning: hardware counters unavailable (not built with "
+                              << "PROFILE=1, or refused by perf_event_open)\n";
+                }
+            } else if (arg == "--curve") {
+                curve_output = true;
+            } else if ((arg == "--ratio" || arg == "--min-prefix") && i + 1 < argc) {
+                std::string value = argv[++i];
+                if (arg == "--ratio") {
+                    options.ratio = parse_number<double>(arg, value);
+                } else {
+                    options.min_prefix = parse_number<int>(arg, value);
+                }
+            } else if (arg == "--overlap") {
+                options.variant = OVERLAPPING;
+            } else if (arg == "--cost" && i + 1 < argc) {
+                std::string value = argv[++i];
+                if (value == "kkp") {
+                    options.cost = COST_KKP;
+                } else if (value == "gamma") {
+                    options.cost = COST_GAMMA;
+                } else if (value == "delta") {
+                    options.cost = COST_DELTA;
+                } else if (value == "fixed") {
+                    options.cost = COST_FIXED;
+                } else {
+                    std::cerr << "Unknown cost model: " << value << "\n";
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            } else if (arg == "--lpf" && i + 1 < argc) {
+                lpf_filename = argv[++i];
+            } else if (arg == "--shuffles" && i + 1 < argc) {
+                n_shuffles = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--null" && i + 1 < argc) {
+                null_models.push_back(parse_null_model(argv[++i]));
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = parse_number<unsigned long long>(arg, argv[++i]);
+            } else if (arg == "-j" && i + 1 < argc) {
+                n_threads = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--frames" && i + 1 < argc) {
+                window_frames = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--stride" && i + 1 < argc) {
+                stride = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--sample") {
+                sampled = true;
+            } else if (arg == "--samples" && i + 1 < argc) {
+                sample.samples = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--sample-window" && i + 1 < argc) {
+                sample.window = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--time-budget" && i + 1 < argc) {
+                sample.time_budget = parse_number<double>(arg, argv[++i]);
+            } else if (arg == "--window" && i + 1 < argc) {
+                streaming = true;
+                stream.window = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--max-chain" && i + 1 < argc) {
+                stream.max_chain = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "--rows" && i + 1 < argc) {
+                row_length = parse_number<long long>(arg, argv[++i]);
+            } else if (arg == "--row-lengths" && i + 1 < argc) {
+                row_lengths_filename = argv[++i];
+            } else if (arg == "--mi") {
+                mutual = true;
+            } else if (arg == "--mem-budget" && i + 1 < argc) {
+                mem_budget = parse_size(argv[++i]);
+            } else if (arg == "--huge-pages" && i + 1 < argc) {
+                set_huge_pages(parse_huge_pages(argv[++i]));
+            } else if (arg == "--online") {
+                online = true;
+            } else if (arg == "--chunk" && i + 1 < argc) {
+                chunk = parse_number<int>(arg, argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                print_usage(argv[0]);
+                return 0;
+            } else if (arg[0] == '-' && arg != "-") {
+                std::cerr << "Unknown option: " << arg << "\n";
+                print_usage(argv[0]);
+                return 1;
+            } else {
+                filenames.push_back(arg);
+            }
         }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
     }
-    
-    if (filename.empty()) {
+
+    if (filenames.empty()) {
         std::cerr << "Error: No input file specified\n\n";
         print_usage(argv[0]);
         return 1;
     }
     
     try {
-        // Read file
-        std::ifstream file(filename, std::ios::binary);
-        if (!file) {
-            throw std::runtime_error("Cannot open file: " + filename);
+        if (window_frames > 0) {
+            std::vector<std::string> frames;
+            for (const auto& name : filenames) {
+                frames.push_back(read_file(name, frames.size()));
+            }
+            auto windows = compute_windowed_cid(frames, window_frames, stride, n_threads,
+                                                options);
+            if (verbose) {
+                std::cout << "First frame\tlength\tfactors\tcid\n";
+            }
+            for (const auto& w : windows) {
+                std::cout << w.first_frame << "\t" << w.stats.length << "\t"
+                          << w.stats.factors << "\t" << w.stats.cid << "\n";
+            }
+            return 0;
+        }
+        
+        if (mutual) {
+            if (filenames.size() != 2) {
+                throw std::runtime_error("--mi needs exactly two channel files");
+            }
+            std::string a = read_file(filenames[0]);
+            std::string b = read_file(filenames[1]);
+            if (a.length() != b.length()) {
+                throw std::runtime_error("Channels differ in length");
+            }
+            Workspace ws;
+            auto info = compute_mutual_information(
+                reinterpret_cast<const unsigned char*>(a.data()),
+                reinterpret_cast<const unsigned char*>(b.data()), a.length(), ws, options);
+            if (verbose) {
+                std::cout << "Cells:                " << info.a.length << "\n";
+                std::cout << "CID(A):               " << info.a.cid << "\n";
+                std::cout << "CID(B):               " << info.b.cid << "\n";
+                std::cout << "CID(AB) pairs:        " << info.joint.cid << "\n";
+                std::cout << "CID(B|A):             " << info.conditional.cid << "\n";
+                std::cout << "MI (joint):           " << info.mi_joint << "\n";
+                std::cout << "MI (conditional):     " << info.mi_conditional << "\n";
+            } else {
+                std::cout << info.a.cid << "\t" << info.b.cid << "\t" << info.joint.cid << "\t"
+                          << info.conditional.cid << "\t" << info.mi_joint << "\t"
+                          << info.mi_conditional << "\n";
+            }
+            return 0;
+        }
+        
+        if (filenames.size() > 1) {
+            throw std::runtime_error("More than one input file (use --frames for a trajectory)");
+        }
+        const std::string& filename = filenames[0];
+        
+        if (row_length > 0 || !row_lengths_filename.empty()) {
+            std::string data = read_file(filename);
+            std::vector<long long> offsets = {0};
+            if (row_length > 0) {
+                if (data.length() % row_length != 0) {
+                    throw std::runtime_error("Input is not a whole number of rows");
+                }
+                for (size_t end = row_length; end <= data.length(); end += row_length) {
+                    offsets.push_back(end);
+                }
+            } else {
+                std::string lengths = read_file(row_lengths_filename);
+                for (size_t k = 0; k + sizeof(long long) <= lengths.length(); k += sizeof(long long)) {
+                    long long length;
+                    std::memcpy(&length, lengths.data() + k, sizeof(long long));
+                    offsets.push_back(offsets.back() + length);
+                }
+                if (offsets.back() != static_cast<long long>(data.length())) {
+                    throw std::runtime_error("Row lengths do not add up to the input length");
+                }
+            }
+            if (mem_budget > 0) {
+                long long longest = 0;
+                for (size_t r = 0; r + 1 < offsets.size(); r++) {
+                    longest = std::max(longest, offsets[r + 1] - offsets[r]);
+                }
+                EnginePlan plan = plan_cid(longest, mem_budget, data.length());
+                if (plan.engine != ENGINE_SUFFIX_ARRAY) {
+                    throw std::runtime_error("Longest row does not fit in the memory budget");
+                }
+                n_threads = plan_threads(mem_budget, data.length(), suffix_array_bytes(longest),
+                                         n_threads, offsets.size() - 1);
+                plan.n_threads = n_threads;
+                plan.peak_bytes = data.length() + n_threads * suffix_array_bytes(longest);
+                std::cerr << describe_plan(plan) << "\n";
+            }
+            auto rows = compute_cid_batch(reinterpret_cast<const unsigned char*>(data.data()),
+                                          offsets, n_threads, options);
+            if (verbose) {
+                std::cout << "Row\tlength\tfactors\tcid\tseconds\n";
+            }
+            for (size_t r = 0; r < rows.size(); r++) {
+                std::cout << r << "\t" << rows[r].stats.length << "\t" << rows[r].stats.factors
+                          << "\t" << rows[r].stats.cid << "\t" << rows[r].seconds << "\n";
+            }
+            return 0;
         }
         
-        std::string data((std::istreambuf_iterator<char>(file)),
-                         std::istreambuf_iterator<char>());
+        if (sampled) {
+            sample.seed = seed;
+            if (mem_budget > 0) {
+                // Each worker holds one window and its workspace
+                long long per_worker = sample.window + suffix_array_bytes(sample.window);
+                EnginePlan plan = {ENGINE_SUFFIX_ARRAY, 0, 1, 0, mem_budget};
+                plan.n_threads = plan_threads(mem_budget, 0, per_worker, n_threads,
+                                              sample.samples);
+                plan.peak_bytes = plan.n_threads * per_worker;
+                n_threads = plan.n_threads;
+                std::cerr << describe_plan(plan) << "\n";
+            }
+            auto est = estimate_cid(filename, sample, n_threads, options);
+            if (tab_output) {
+                std::cout << est.length << "\t" << est.factors << "\t" << est.cid << "\t"
+                          << est.cid_low << "\t" << est.cid_high << "\t" << est.samples << "\t"
+                          << est.sampling_low << "\t" << est.sampling_high << "\n";
+            } else if (verbose) {
+                std::cout << "Input length:         " << est.length << " bytes\n";
+                std::cout << "Windows:              " << est.samples << " x " << est.window << "\n";
+                std::cout << "Window CID (mean):    " << est.window_cid << "\n";
+                std::cout << "LZ77 rate (fitted):   " << est.rate << "\n";
+                std::cout << "LZ77 factors (est.):  " << est.factors << "\n";
+                std::cout << "CID (estimate):       " << est.cid << "\n";
+                std::cout << "CID 95% interval:     " << est.cid_low << " - " << est.cid_high
+                          << "\n";
+                std::cout << "Window sampling 95%:  " << est.sampling_low << " - "
+                          << est.sampling_high << "\n";
+                std::cout << "Time:                 " << est.seconds << " s\n";
+            } else {
+                std::cout << est.cid << "\n";
+            }
+            return 0;
+        }
+        
+        // Exact engine if the input and its workspace fit, otherwise the
+        // windowed parse streamed from disk
+        EnginePlan plan = {};
+        if (mem_budget > 0 && !streaming && !online) {
+            std::ifstream probe(filename, std::ios::binary | std::ios::ate);
+            if (!probe) {
+                throw std::runtime_error("Cannot open file: " + filename);
+            }
+            long long length = probe.tellg();
+            plan = plan_cid(length, mem_budget, length, true);
+            if (plan.engine == ENGINE_WINDOWED) {
+                if (n_shuffles > 0 || !lpf_filename.empty()) {
+                    throw std::runtime_error(
+                        "Input too long for the memory budget with --shuffles or --lpf");
+                }
+                streaming = true;
+                stream.window = plan.window;
+            } else if (n_shuffles > 0) {
+                // The main workspace is released before the shuffles; each
+                // worker holds a shuffled copy and its own workspace
+                long long per_worker = length + suffix_array_bytes(length);
+                int jobs = n_shuffles * std::max<size_t>(1, null_models.size());
+                n_threads = plan_threads(mem_budget, length, per_worker, n_threads, jobs);
+                plan.n_threads = n_threads;
+                plan.peak_bytes = std::max(plan.peak_bytes, length + n_threads * per_worker);
+            }
+            std::cerr << describe_plan(plan) << "\n";
+        }
+        // The plan for -t and --json, empty without a budget
+        std::string plan_fields;
+        std::string plan_object;
+        if (plan.budget > 0) {
+            plan_fields = std::string("\t") + engine_name(plan.engine) + "\t" +
+                          std::to_string(plan.window) + "\t" + std::to_string(plan.n_threads) +
+                          "\t" + std::to_string(plan.peak_bytes);
+            plan_object = std::string(",\n \"plan\": {\"engine\": \"") +
+                          engine_name(plan.engine) + "\", \"window\": " +
+                          std::to_string(plan.window) + ", \"n_threads\": " +
+                          std::to_string(plan.n_threads) + ", \"peak_bytes\": " +
+                          std::to_string(plan.peak_bytes) + ", \"budget\": " +
+                          std::to_string(plan.budget) + "}";
+        }
+        
+        // Streamed inputs print their lines as the parse passes them
+        std::ifstream file;
+        if ((streaming || online) && filename != "-") {
+            file.open(filename, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Cannot open file: " + filename);
+            }
+        }
+        std::istream& in = filename == "-" ? std::cin : file;
+        std::function<void(const CompressionStats&)> print_prefix =
+            [](const CompressionStats& point) {
+                std::cout << point.length << "\t" << point.factors << "\t"
+                          << point.cid << std::endl;
+            };
+        
+        if (online) {
+            if (verbose) {
+                std::cout << "Length so far\tLZ77 factors\tCID\n";
+            }
+            compute_online_cid(in, chunk, options, print_prefix);
+            return 0;
+        }
+        
+        if (streaming) {
+            auto stats = compute_streaming_cid(in, stream, options,
+                                               curve_output ? print_prefix : nullptr);
+            if (curve_output) {
+                print_prefix(stats);
+            } else if (tab_output) {
+                std::cout << stats.length << "\t" << stats.factors << "\t" << stats.cid
+                          << plan_fields << "\n";
+            } else if (json_output) {
+                std::cout << "{\"length\": " << stats.length << ", \"factors\": " << stats.factors
+                          << ", \"compressed_bits\": " << std::to_string(stats.compressed_bits)
+                          << ", \"cid\": " << std::to_string(stats.cid) << plan_object << "}\n";
+            } else if (verbose) {
+                std::cout << "Input length:         " << stats.length << " bytes\n";
+                std::cout << "Window:               " << stream.window << "\n";
+                std::cout << "LZ77 factors:         " << stats.factors << "\n";
+                std::cout << "Compressed size:      " << stats.compressed_bits << " bits\n";
+                std::cout << "CID (bits/char):      " << stats.cid << "\n";
+            } else {
+                std::cout << stats.cid << "\n";
+            }
+            return 0;
+        }
+        
+        std::string data = read_file(filename);
         
         if (verbose) {
             std::cerr << "Read " << data.length() << " bytes from " << filename << "\n";
+            std::cerr << "Kernels: " << kernel_isa() << "\n";
+        }
+        
+        Workspace ws;
+        
+        if (!lpf_filename.empty()) {
+            if (data.empty()) {
+                throw std::runtime_error("Empty input");
+            }
+            int length = data.length();
+            compute_lpf(reinterpret_cast<const unsigned char*>(data.c_str()), length, ws);
+            
+            std::ofstream lpf_file(lpf_filename, std::ios::binary);
+            lpf_file.write(reinterpret_cast<const char*>(ws.lpf.data()), sizeof(int) * length);
+            lpf_file.write(reinterpret_cast<const char*>(ws.prev_occ.data()), sizeof(int) * length);
+            if (!lpf_file) {
+                throw std::runtime_error("Cannot write file: " + lpf_filename);
+            }
+            if (verbose) {
+                std::cerr << "Wrote LPF arrays to " << lpf_filename << "\n";
+            }
         }
         
         // Compute CID
-        auto stats = compute_cid(data);
+        std::vector<CompressionStats> curve;
+        CompressionStats stats;
+        {
+            TraceSpan span("cid", 0, data.length());
+            stats = compute_cid(data, ws, options, curve_output ? &curve : nullptr);
+        }
+        
+        std::vector<BaselineResult> baselines;
+        if (n_shuffles > 0) {
+            if (null_models.empty()) {
+                null_models.push_back({NULL_PERMUTATION, 0});
+            }
+            if (mem_budget > 0) {
+                ws = Workspace();
+            }
+            baselines = compute_baselines(reinterpret_cast<const unsigned char*>(data.c_str()),
+                                          stats.length, null_models, n_shuffles, seed,
+                                          n_threads, options);
+        }
         
         // Output
-        if (tab_output) {
+        if (json_output) {
+            auto stats_json = [](const CompressionStats& point) {
+                return "{\"length\": " + std::to_string(point.length) +
+                       ", \"factors\": " + std::to_string(point.factors) +
+                       ", \"compressed_bits\": " + std::to_string(point.compressed_bits) +
+                       ", \"cid\": " + std::to_string(point.cid) + "}";
+            };
+            std::string json = stats_json(stats);
+            json.pop_back();
+            std::cout << json;
+            if (curve_output) {
+                std::cout << ",\n \"curve\": [";
+                for (size_t k = 0; k < curve.size(); k++) {
+                    std::cout << (k ? ", " : "") << stats_json(curve[k]);
+                }
+                std::cout << "]";
+            }
+            if (!baselines.empty()) {
+                std::cout << ",\n \"baselines\": [";
+                for (size_t k = 0; k < baselines.size(); k++) {
+                    std::string baseline = stats_json(baselines[k].stats);
+                    baseline.pop_back();
+                    std::cout << (k ? ", " : "") << baseline << ", \"null_model\": \""
+                              << null_model_name(baselines[k].spec) << "\", \"replicate\": "
+                              << baselines[k].replicate << "}";
+                }
+                std::cout << "]";
+            }
+            std::cout << plan_object;
+            std::cout << ",\n \"profile\": " << profile_json(profile_report()) << "}\n";
+            return 0;
+        }
+        if (curve_output) {
+            if (verbose) {
+                std::cout << "Prefix length\tLZ77 factors\tCompressed bits\tCID\n";
+            }
+            for (const auto& point : curve) {
+                std::cout << point.length << "\t" << point.factors << "\t";
+                if (verbose) {
+                    std::cout << point.compressed_bits << "\t";
+                }
+                std::cout << point.cid << "\n";
+            }
+        } else if (tab_output) {
             std::cout << stats.length << "\t" 
                      << stats.factors << "\t" 
-                     << stats.cid << "\n";
+                     << stats.cid << plan_fields << "\n";
         } else if (verbose) {
             std::cout << "Input length:         " << stats.length << " bytes\n";
             std::cout << "LZ77 factors:         " << stats.factors << "\n";
@@ -191,10 +641,30 @@ int main(int argc, char* argv[]) {
             std::cout << "Compressed size:      " << stats.compressed_bits / 8.0 << " bytes\n";
             std::cout << "Compression ratio:    " << (1.0 - stats.compressed_bits / (stats.length * 8.0)) << "\n";
             std::cout << "CID (bits/char):      " << stats.cid << "\n";
+            const char* names[NUM_VARIANTS] = {"non-overlapping", "overlapping"};
+            std::cout << "\nVariant\t\tfactors\tkkp\tgamma\tdelta\tfixed (bits)\n";
+            for (int v = 0; v < NUM_VARIANTS; v++) {
+                const ParseStats& p = stats.parse.variant[v];
+                std::cout << names[v] << "\t" << p.factors << "\t"
+                          << kkp_bits(p.factors, stats.length) << "\t"
+                          << p.gamma_bits << "\t" << p.delta_bits << "\t"
+                          << p.fixed_bits << "\n";
+            }
+            print_profile(profile_report());
         } else {
             std::cout << stats.cid << "\n";
         }
         
+        // One line per baseline: null model, replicate, length, factors, cid
+        if (verbose && !baselines.empty()) {
+            std::cout << "\nNull model\treplicate\tlength\tfactors\tcid\n";
+        }
+        for (const auto& baseline : baselines) {
+            std::cout << null_model_name(baseline.spec) << "\t" << baseline.replicate << "\t"
+                      << baseline.stats.length << "\t" << baseline.stats.factors << "\t"
+                      << baseline.stats.cid << "\n";
+        }
+        
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
@@ -0,0 +1,35 @@
+// mutual.h - Compression-based mutual information between two channels
+// Two channels are symbol buffers of equal length over the same Hilbert
+// ordered cells (e.g. framework and guest atoms binned on one grid). The
+// information they share shows up as compression gained by seeing both:
+//   joint:        C(A) + C(B) - C(AB), AB one symbol per cell for the pair
+//                 (a, b), numbered in order of first appearance
+//   conditional:  C(B) - C(B|A), B parsed with all of A as a reference
+// where C is the compressed size of the selected cost model. Both are near
+// 0 for independent channels (small and positive: LZ77 overestimates the
+// entropy of short strings a little more for the larger alphabet or the
+// longer string) and near C(A) for B = A; under KKP the conditional form
+// then falls short of C(A) by about 2 bits per phrase of A, the cost of
+// addressing a string twice as long.
+
+#ifndef MUTUAL_H
+#define MUTUAL_H
+
+#include "lz77.h"
+
+struct ChannelInformation {
+    CompressionStats a;
+    CompressionStats b;
+    CompressionStats joint;        // pair symbols, length symbols
+    CompressionStats conditional;  // B given A; cid per symbol of B
+    double mi_joint;               // in CID units: bits / (8 * length)
+    double mi_conditional;
+};
+
+// The suffix array of A followed by B serves both C(B|A) and, restricted to
+// the positions of A, C(A), so A is never sorted on its own.
+ChannelInformation compute_mutual_information(const unsigned char* a, const unsigned char* b,
+                                              int length, Workspace& ws,
+                                              const CidOptions& options = CidOptions());
+
+#endif // MUTUAL_H
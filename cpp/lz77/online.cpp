@@ -0,0 +1,158 @@
+// online.cpp - Online LZ77 over append-only input with a suffix automaton
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+#include "online.h"
+
+OnlineParser::OnlineParser() {
+    std::fill(code_, code_ + 256, -1);
+    add_state(0, -1, -1);
+}
+
+int OnlineParser::add_state(int len, int link, int firstpos) {
+    len_.push_back(len);
+    link_.push_back(link);
+    firstpos_.push_back(firstpos);
+    next_.resize(next_.size() + width_, -1);
+    return static_cast<int>(len_.size()) - 1;
+}
+
+void OnlineParser::widen() {
+    int width = width_ * 2;
+    std::vector<int> next(len_.size() * width, -1);
+    for (size_t s = 0; s < len_.size(); s++) {
+        std::copy(next_.begin() + s * width_, next_.begin() + (s + 1) * width_,
+                  next.begin() + s * width);
+    }
+    next_.swap(next);
+    width_ = width;
+}
+
+// Standard suffix automaton extension by the symbol at position k; each
+// state also keeps the end of its first occurrence, which a clone shares
+// with the state it was split from
+void OnlineParser::extend(int code, int k) {
+    int cur = add_state(len_[last_] + 1, -1, k);
+    int p = last_;
+    while (p != -1 && transition(p, code) == -1) {
+        next_[p * width_ + code] = cur;
+        p = link_[p];
+    }
+    if (p == -1) {
+        link_[cur] = 0;
+    } else {
+        int q = transition(p, code);
+        if (len_[p] + 1 == len_[q]) {
+            link_[cur] = q;
+        } else {
+            int clone = add_state(len_[p] + 1, link_[q], firstpos_[q]);
+            std::copy(next_.begin() + q * width_, next_.begin() + (q + 1) * width_,
+                      next_.begin() + clone * width_);
+            while (p != -1 && transition(p, code) == q) {
+                next_[p * width_ + code] = clone;
+                p = link_[p];
+            }
+            link_[q] = clone;
+            link_[cur] = clone;
+        }
+    }
+    last_ = cur;
+}
+
+void OnlineParser::close_phrase(ParseStats& stats, const Phrase& phrase) const {
+    // The first occurrence of the phrase starts before it in both variants
+    int src = firstpos_[phrase.state] - phrase.len + 1;
+    add_phrase(stats, phrase.len, phrase.start - src, 0);
+}
+
+// Try to extend the phrase in progress by the symbol at position k, with
+// the automaton holding text[0..k). The overlapping variant needs
+// text[start..k] to occur ending before k, which is any transition; the
+// non-overlapping one needs its first occurrence to end before start.
+void OnlineParser::step(ParseVariant variant, int code, int k) {
+    Phrase& phrase = phrase_[variant];
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int target = transition(phrase.state, code);
+        if (target != -1 && (variant == OVERLAPPING || firstpos_[target] < phrase.start)) {
+            phrase.state = target;
+            phrase.len++;
+            return;
+        }
+        if (phrase.len == 0) {
+            break;
+        }
+        close_phrase(result_.variant[variant], phrase);
+        phrase = Phrase();
+        phrase.start = k;
+    }
+    // Literal
+    add_phrase(result_.variant[variant], 0, 0, 0);
+    phrase = Phrase();
+    phrase.start = k + 1;
+}
+
+void OnlineParser::append(const unsigned char* data, size_t count) {
+    if (count > static_cast<size_t>(INT_MAX / 2 - end_)) {
+        throw std::runtime_error("Input too long for the online engine");
+    }
+    for (size_t n = 0; n < count; n++) {
+        int& code = code_[data[n]];
+        if (code == -1) {
+            code = sigma_++;
+            if (code == width_) {
+                widen();
+            }
+        }
+
+        int k = end_;
+        step(NON_OVERLAPPING, code, k);
+        step(OVERLAPPING, code, k);
+        extend(code, k);
+        end_++;
+
+        // A clone may have taken over the phrase strings: move down the
+        // suffix links to the state that now holds the current length
+        for (auto& phrase : phrase_) {
+            while (phrase.state != 0 && len_[link_[phrase.state]] >= phrase.len) {
+                phrase.state = link_[phrase.state];
+            }
+        }
+    }
+}
+
+ParseResult OnlineParser::parse() const {
+    ParseResult result = result_;
+    int fixed_len = end_ > 0 ? fixed_phrase_bits(end_) : 0;
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        if (phrase_[v].len > 0) {
+            close_phrase(result.variant[v], phrase_[v]);
+        }
+        result.variant[v].fixed_bits = result.variant[v].factors * fixed_len;
+    }
+    return result;
+}
+
+CompressionStats compute_online_cid(
+    std::istream& in, int chunk, const CidOptions& options,
+    const std::function<void(const CompressionStats&)>& on_chunk) {
+    if (chunk < 1) {
+        throw std::runtime_error("Chunk size must be at least 1");
+    }
+    OnlineParser parser;
+    std::vector<char> buffer(chunk);
+    while (in.read(buffer.data(), chunk) || in.gcount() > 0) {
+        parser.append(reinterpret_cast<const unsigned char*>(buffer.data()), in.gcount());
+        if (on_chunk) {
+            on_chunk(make_stats(parser.parse(), parser.length(), options));
+        }
+    }
+    if (in.bad()) {
+        throw std::runtime_error("Cannot read input stream");
+    }
+    if (parser.length() == 0) {
+        throw std::runtime_error("Empty input");
+    }
+    return make_stats(parser.parse(), parser.length(), options);
+}
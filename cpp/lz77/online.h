@@ -0,0 +1,76 @@
+// online.h - Online LZ77 over append-only input with a suffix automaton
+// The suffix automaton of everything appended so far is extended one symbol
+// at a time, and the phrase in progress of each variant is followed as a
+// state of that automaton, so the running parse is known after every
+// appended chunk without waiting for the whole text. Amortized O(1) per
+// symbol for a fixed alphabet.
+
+#ifndef ONLINE_H
+#define ONLINE_H
+
+#include <functional>
+#include <istream>
+#include <vector>
+
+#include "lz77.h"
+
+// Greedy parse of both variants (see ParseVariant), identical in phrase
+// count to lz77_factorize on every prefix. A phrase copies from the first
+// occurrence of its source, so gamma/delta costs may differ from the
+// suffix-array engine, which is free to pick any occurrence.
+//
+// Transitions are stored as dense rows over the symbols seen so far, with
+// the row width doubled (4, 8, ..., 256) whenever a new symbol does not
+// fit. Binned grids use a handful of symbols, so a state costs a few words.
+class OnlineParser {
+public:
+    OnlineParser();
+
+    void append(const unsigned char* data, size_t count);
+
+    // Symbols appended so far
+    long long length() const { return end_; }
+
+    // Greedy parse of the input so far; the phrase in progress is counted
+    // with its current length, as in the parse of this prefix
+    ParseResult parse() const;
+
+private:
+    struct Phrase {
+        int start = 0;  // text position of the phrase in progress
+        int state = 0;  // automaton state of text[start..start + len)
+        int len = 0;
+    };
+
+    int transition(int state, int code) const { return next_[state * width_ + code]; }
+    int add_state(int len, int link, int firstpos);
+    void widen();
+    void step(ParseVariant variant, int code, int k);
+    void extend(int code, int k);
+    void close_phrase(ParseStats& stats, const Phrase& phrase) const;
+
+    // Automaton: per state the longest string length, suffix link, end of
+    // the first occurrence and a row of width_ transitions (-1 = none)
+    std::vector<int> len_;
+    std::vector<int> link_;
+    std::vector<int> firstpos_;
+    std::vector<int> next_;
+    int width_ = 4;
+    int last_ = 0;
+
+    int code_[256];   // dense code of each symbol, -1 if not seen yet
+    int sigma_ = 0;
+
+    int end_ = 0;
+    Phrase phrase_[NUM_VARIANTS];
+    ParseResult result_ = {};
+};
+
+// CID of a stream, read and parsed chunk by chunk. on_chunk (if given)
+// receives the stats of the input so far after every chunk; the last call
+// is the whole input.
+CompressionStats compute_online_cid(
+    std::istream& in, int chunk, const CidOptions& options = CidOptions(),
+    const std::function<void(const CompressionStats&)>& on_chunk = nullptr);
+
+#endif // ONLINE_H
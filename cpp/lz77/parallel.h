@@ -0,0 +1,57 @@
+// parallel.h - Minimal parallel job executor shared by the CID engines
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Number of workers for n_jobs jobs: n_threads, or all cores if <= 0,
+// never more than the number of jobs (and at least 1)
+inline int resolve_threads(int n_threads, size_t n_jobs) {
+    if (n_threads <= 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(n_threads, n_jobs)));
+}
+
+// Run job(index, worker) for every index in [0, n_jobs) on n_workers threads
+// (see resolve_threads); worker in [0, n_workers) lets jobs use per-worker
+// state such as a Workspace. Jobs are claimed in index order. The calling
+// thread is worker 0. The first exception thrown by a job stops the
+// remaining jobs and is rethrown.
+template <typename Job>
+void parallel_for(size_t n_jobs, int n_workers, Job job) {
+    std::atomic<size_t> next_job(0);
+    std::vector<std::exception_ptr> errors(n_workers);
+
+    auto worker = [&](int w) {
+        try {
+            for (size_t index = next_job++; index < n_jobs; index = next_job++) {
+                job(index, w);
+            }
+        } catch (...) {
+            errors[w] = std::current_exception();
+            next_job = n_jobs;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < n_workers; w++) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,84 @@
+// pool.cpp - Long-lived worker pool for jobs that arrive over time
+
+#include <chrono>
+#include <cstdint>
+
+#include "parallel.h"
+#include "pool.h"
+
+JobPool::JobPool(int n_threads, int max_in_flight) {
+    int n_workers = resolve_threads(n_threads, SIZE_MAX);
+    max_in_flight_ = max_in_flight > 0 ? max_in_flight : 2 * n_workers;
+    for (int w = 0; w < n_workers; w++) {
+        threads_.emplace_back(&JobPool::work, this);
+    }
+}
+
+JobPool::~JobPool() {
+    close();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+long long JobPool::submit(Job job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    window_open_.wait(lock, [&]() { return closed_ || in_flight_ < max_in_flight_; });
+    if (closed_) {
+        return 0;
+    }
+    long long id = next_id_++;
+    in_flight_++;
+    queue_.emplace_back(id, std::move(job));
+    job_ready_.notify_one();
+    return id;
+}
+
+long long JobPool::wait(double timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [&]() { return closed_ || !finished_.empty(); };
+    if (timeout < 0) {
+        job_done_.wait(lock, ready);
+    } else {
+        job_done_.wait_for(lock, std::chrono::duration<double>(timeout), ready);
+    }
+    if (closed_ || finished_.empty()) {
+        return 0;
+    }
+    long long id = finished_.front();
+    finished_.pop_front();
+    in_flight_--;
+    window_open_.notify_one();
+    return id;
+}
+
+void JobPool::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    queue_.clear();
+    job_ready_.notify_all();
+    job_done_.notify_all();
+    window_open_.notify_all();
+}
+
+void JobPool::work() {
+    // Starts empty and is first filled on this thread, like the batch
+    // executor's per-worker workspaces
+    Workspace ws;
+    while (true) {
+        std::pair<long long, Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_ready_.wait(lock, [&]() { return closed_ || !queue_.empty(); });
+            if (closed_) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        job.second(job.first, ws);
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_.push_back(job.first);
+        job_done_.notify_one();
+    }
+}
@@ -0,0 +1,67 @@
+// pool.h - Long-lived worker pool for jobs that arrive over time
+// parallel_for runs a known set of jobs and returns when all are done. A
+// JobPool instead keeps its threads, and their Workspaces, across jobs
+// submitted one at a time (files handed over from Python while earlier
+// ones are still being processed) and hands back job ids in completion
+// order. At most max_in_flight jobs are submitted and not yet collected by
+// wait(); submit blocks beyond that, which caps the memory held by queued
+// inputs and uncollected results however fast jobs are submitted.
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "lz77.h"
+
+class JobPool {
+public:
+    // A job gets its id and the Workspace of the worker that runs it; it
+    // must not throw
+    using Job = std::function<void(long long id, Workspace& ws)>;
+
+    // n_threads workers (0 = all cores); max_in_flight <= 0 means two jobs
+    // per worker
+    JobPool(int n_threads, int max_in_flight);
+    ~JobPool();
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    // Queue job and return its id (1, 2, ...), waiting while the window is
+    // full; 0 once the pool is closed
+    long long submit(Job job);
+
+    // Id of the next finished job, waiting up to timeout seconds (< 0: no
+    // limit, until a job finishes or the pool is closed); 0 on timeout or
+    // once closed
+    long long wait(double timeout);
+
+    // Drop the queued jobs, let running ones finish and wake every waiter
+    void close();
+
+    int threads() const { return static_cast<int>(threads_.size()); }
+    int max_in_flight() const { return max_in_flight_; }
+
+private:
+    void work();
+
+    std::mutex mutex_;
+    std::condition_variable job_ready_;    // queue_ not empty, or closed
+    std::condition_variable job_done_;     // finished_ not empty, or closed
+    std::condition_variable window_open_;  // in_flight_ below the window, or closed
+    std::deque<std::pair<long long, Job>> queue_;
+    std::deque<long long> finished_;
+    std::vector<std::thread> threads_;
+    long long next_id_ = 1;
+    int in_flight_ = 0;
+    int max_in_flight_;
+    bool closed_ = false;
+};
+
+#endif // POOL_H
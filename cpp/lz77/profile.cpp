@@ -0,0 +1,249 @@
+// profile.cpp - Per-phase timing and memory instrumentation
+
+#include <sstream>
+
+#include "profile.h"
+
+#ifdef LZ_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <sys/resource.h>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<long long> total_allocated(0);
+
+std::mutex profile_mutex;
+std::vector<PhaseProfile>& phases() {
+    static std::vector<PhaseProfile> list;
+    return list;
+}
+
+long long peak_rss_bytes() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<long long>(usage.ru_maxrss) * 1024;  // kilobytes on Linux
+}
+
+std::atomic<bool> counters_enabled(false);
+
+#ifdef __linux__
+
+// (type, config) of each HardwareCounter
+const std::pair<unsigned, unsigned long long> EVENTS[NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+// Counters of the calling thread, user space only (permitted at the default
+// perf_event_paranoid level), opened on first use and kept for the life of
+// the thread; -1 where the open failed
+struct ThreadCounters {
+    int fd[NUM_COUNTERS];
+
+    ThreadCounters() {
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = EVENTS[c].first;
+            attr.config = EVENTS[c].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[c] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+    }
+
+    ~ThreadCounters() {
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fd[c] >= 0) {
+                close(fd[c]);
+            }
+        }
+    }
+
+    // Count so far, scaled up if the kernel multiplexed the counter
+    long long read_counter(int c) const {
+        unsigned long long values[3];
+        if (fd[c] < 0 || ::read(fd[c], values, sizeof(values)) != sizeof(values)) {
+            return -1;
+        }
+        if (values[2] == 0) {
+            return 0;
+        }
+        return static_cast<long long>(static_cast<double>(values[0]) * values[1] / values[2]);
+    }
+};
+
+ThreadCounters& thread_counters() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+#endif // __linux__
+
+// Current counts of the calling thread, all -1 when disabled or unsupported
+void read_counters(long long* counts) {
+    std::fill(counts, counts + NUM_COUNTERS, -1LL);
+#ifdef __linux__
+    if (counters_enabled.load(std::memory_order_relaxed)) {
+        const ThreadCounters& counters = thread_counters();
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            counts[c] = counters.read_counter(c);
+        }
+    }
+#endif
+}
+
+}  // namespace
+
+// Count every allocation made through operator new (std::vector, strings);
+// divsufsort's small malloc buffers are not included
+void* operator new(std::size_t size) {
+    total_allocated.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void profile_note_allocation(long long bytes) {
+    total_allocated.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+PhaseTimer::PhaseTimer(const char* name)
+    : name_(name),
+      start_(std::chrono::steady_clock::now()),
+      allocated_(total_allocated.load(std::memory_order_relaxed)) {
+    read_counters(counters_);
+}
+
+PhaseTimer::~PhaseTimer() {
+    long long counters[NUM_COUNTERS];
+    read_counters(counters);
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        counters[c] = counters_[c] >= 0 && counters[c] >= 0 ? counters[c] - counters_[c] : -1;
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+    long long allocated = total_allocated.load(std::memory_order_relaxed) - allocated_;
+    long long rss = peak_rss_bytes();
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (auto& phase : phases()) {
+        if (phase.name == name_) {
+            phase.calls++;
+            phase.seconds += seconds;
+            phase.bytes_allocated += allocated;
+            phase.peak_rss = std::max(phase.peak_rss, rss);
+            for (int c = 0; c < NUM_COUNTERS; c++) {
+                phase.counters[c] = phase.counters[c] >= 0 && counters[c] >= 0
+                    ? phase.counters[c] + counters[c] : -1;
+            }
+            return;
+        }
+    }
+    PhaseProfile phase = {name_, 1, seconds, allocated, rss, {}};
+    std::copy(counters, counters + NUM_COUNTERS, phase.counters);
+    phases().push_back(phase);
+}
+
+std::vector<PhaseProfile> profile_report() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    return phases();
+}
+
+void profile_reset() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    phases().clear();
+}
+
+bool profile_set_counters(bool enabled) {
+    counters_enabled = enabled;
+    if (!enabled) {
+        return true;
+    }
+    long long counts[NUM_COUNTERS];
+    read_counters(counts);
+    return std::any_of(counts, counts + NUM_COUNTERS, [](long long c) { return c >= 0; });
+}
+
+#else
+
+std::vector<PhaseProfile> profile_report() {
+    return {};
+}
+
+void profile_reset() {}
+
+void profile_note_allocation(long long) {}
+
+bool profile_set_counters(bool enabled) {
+    return !enabled;
+}
+
+#endif // LZ_PROFILE
+
+const char* const COUNTER_NAMES[NUM_COUNTERS] = {
+    "cycles", "instructions", "branch_misses", "llc_misses", "dtlb_misses"
+};
+
+std::string profile_json(const std::vector<PhaseProfile>& phases) {
+    std::ostringstream out;
+    out << "[";
+    for (size_t k = 0; k < phases.size(); k++) {
+        const PhaseProfile& p = phases[k];
+        out << (k ? ", " : "") << "{\"name\": \"" << p.name << "\", \"calls\": " << p.calls
+            << ", \"seconds\": " << p.seconds << ", \"bytes_allocated\": " << p.bytes_allocated
+            << ", \"peak_rss\": " << p.peak_rss;
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            out << ", \"" << COUNTER_NAMES[c] << "\": ";
+            if (p.counters[c] >= 0) {
+                out << p.counters[c];
+            } else {
+                out << "null";
+            }
+        }
+        out << "}";
+    }
+    out << "]";
+    return out.str();
+}
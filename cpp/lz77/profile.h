@@ -0,0 +1,84 @@
+// profile.h - Built-in per-phase timing and memory instrumentation
+// Engine phases (read, suffix array, LCP, factorization, shuffles) are
+// wrapped in PROFILE_PHASE("name"), which times the enclosing scope on the
+// monotonic clock and records the bytes allocated and the peak RSS when it
+// ends. Build with -DLZ_PROFILE (make PROFILE=1) to enable it; otherwise
+// the macro expands to nothing and profile_report() is always empty.
+// With profile_set_counters(true) each phase also reads hardware counters
+// through perf_event_open (Linux); counters the kernel does not permit or
+// the CPU lacks are reported as -1 and the phase timings are unaffected.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <string>
+#include <vector>
+
+enum HardwareCounter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_LLC_MISSES,     // last-level cache read misses
+    COUNTER_DTLB_MISSES,    // data TLB read misses
+    NUM_COUNTERS
+};
+
+extern const char* const COUNTER_NAMES[NUM_COUNTERS];
+
+// Totals of one phase over all its calls, on any thread
+struct PhaseProfile {
+    std::string name;
+    long long calls;
+    double seconds;            // summed over calls, so may exceed wall time
+    long long bytes_allocated; // operator new, process-wide while it ran
+    long long peak_rss;        // bytes, highest seen at the end of a call
+    long long counters[NUM_COUNTERS];  // of the calling thread, summed over
+                                       // calls; -1 if unavailable
+};
+
+// Phases in the order they first ran
+std::vector<PhaseProfile> profile_report();
+
+void profile_reset();
+
+// Read hardware counters around every phase from now on (off by default);
+// returns false if none of them can be opened on this system, or profiling
+// is not built in
+bool profile_set_counters(bool enabled);
+
+// Count bytes taken by an allocator that bypasses operator new (see
+// hugepage.h); no-op unless profiling is built in
+void profile_note_allocation(long long bytes);
+
+// Report as a JSON array of objects with the PhaseProfile fields
+std::string profile_json(const std::vector<PhaseProfile>& phases);
+
+#ifdef LZ_PROFILE
+
+#include <chrono>
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const char* name);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+    long long allocated_;
+    long long counters_[NUM_COUNTERS];
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_PHASE(name) PhaseTimer PROFILE_CONCAT(phase_timer_, __LINE__)(name)
+
+#else
+
+#define PROFILE_PHASE(name) ((void)0)
+
+#endif // LZ_PROFILE
+
+#endif // PROFILE_H
@@ -0,0 +1,246 @@
+// sampling.cpp - Approximate CID of very large inputs from sampled windows
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "sampling.h"
+#include "shuffle.h"
+#include "trace.h"
+
+namespace {
+
+// Reads `length` symbols at `offset` into out, for worker w
+using WindowReader = std::function<void(long long offset, int length, unsigned char* out, int w)>;
+
+double kkp_bits_real(double factors, double length) {
+    if (factors > 0 && factors < length) {
+        return factors * std::log2(factors) + 2.0 * factors * std::log2(length / factors);
+    }
+    return length * 8.0;
+}
+
+// Rate estimate z log2(l) / l of z phrases in l symbols
+double rate_at(int l, double z) {
+    double length = std::max(2, l);
+    return z * std::log2(length) / length;
+}
+
+// For a stationary ergodic source the LZ77 phrase count grows as
+// z(l) ~ h l / log2 l, with the rate estimate h(l) = z(l) log2(l) / l
+// converging like h + c / log2(l). Fit h and c by least squares over the
+// checkpoints of the last four doublings of the mean window curve and
+// evaluate the rate at the full length.
+double fitted_rate(const std::vector<int>& checkpoints, const std::vector<double>& z,
+                   double length) {
+    int last = checkpoints.size() - 1;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = 0;
+    for (int k = last; k >= 0 && checkpoints[k] * 16L >= checkpoints[last]; k--) {
+        double l = std::max(2, checkpoints[k]);
+        double x = 1.0 / std::log2(l);
+        double y = z[k] * std::log2(l) / l;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+    double window_rate = rate_at(checkpoints[last], z[last]);
+    if (n < 2 || sxx * n - sx * sx <= 0) {
+        return window_rate;
+    }
+    double c = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    double h = (sy - c * sx) / n;
+    double rate = h + c / std::log2(length);
+    // The rate cannot rise with length, nor drop below zero
+    return std::min(window_rate, std::max(0.0, rate));
+}
+
+// Whole-input CID extrapolated from the mean phrase-count curve of the
+// given windows; rate and factors receive the fitted rate and phrase count.
+// Without fit the input is costed as if parsed window by window, at the
+// phrase density of the windows: sources further back can only shorten
+// the parse, so this bounds the CID from above.
+double extrapolate(const std::vector<int>& checkpoints,
+                   const std::vector<std::vector<double>>& curves,
+                   const std::vector<int>& picks, long long length, bool fit,
+                   double* rate, double* factors) {
+    std::vector<double> mean(checkpoints.size(), 0.0);
+    for (int k : picks) {
+        for (size_t c = 0; c < checkpoints.size(); c++) {
+            mean[c] += curves[k][c] / picks.size();
+        }
+    }
+    double n = static_cast<double>(length);
+    double h = fitted_rate(checkpoints, mean, n);
+    double z = fit ? h * n / std::log2(std::max(2.0, n)) : mean.back() * n / checkpoints.back();
+    z = std::max(1.0, z);
+    if (rate) *rate = h;
+    if (factors) *factors = z;
+    return kkp_bits_real(z, n) / (n * 8.0);
+}
+
+SampledEstimate estimate(long long length, const WindowReader& read,
+                         const SampleOptions& sample, int n_threads,
+                         const CidOptions& options) {
+    if (length <= 0) {
+        throw std::runtime_error("Empty input");
+    }
+    if (options.cost != COST_KKP) {
+        throw std::runtime_error("Sampled estimate supports the kkp cost model only");
+    }
+    if (sample.window < 1 || sample.samples < 1) {
+        throw std::runtime_error("Sampling needs a window and at least one sample");
+    }
+    auto start_time = std::chrono::steady_clock::now();
+
+    int window = static_cast<int>(std::min<long long>(sample.window, length));
+    int samples = window == length ? 1 : sample.samples;
+
+    CidOptions curve_options = options;
+    curve_options.min_prefix = std::max(16, window / 1024);
+    curve_options.ratio = 2.0;
+    std::vector<int> checkpoints = geometric_checkpoints(window, curve_options.min_prefix,
+                                                         curve_options.ratio);
+
+    std::vector<std::vector<double>> curves(samples);
+    std::vector<double> window_cids(samples);
+    std::vector<char> done(samples, 0);
+
+    int n_workers = resolve_threads(n_threads, samples);
+    std::vector<Workspace> workspaces(n_workers);
+    std::vector<std::vector<unsigned char>> buffers(n_workers);
+
+    // Windows are claimed in order, but a worker may check the budget after
+    // another has passed it on a later window, so the windows factorized
+    // need not be a prefix; the estimate uses those done, whichever they are
+    parallel_for(samples, n_workers, [&](size_t k, int w) {
+        double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start_time).count();
+        if (sample.time_budget > 0 && k >= 2 && elapsed > sample.time_budget) {
+            return;
+        }
+        Rng rng(sample.seed ^ (0x5a17ULL << 48) ^ k);
+        // Windows wrap around the end of the input, so that every position
+        // is equally likely to be sampled; otherwise the ends, often the
+        // least regular part of a curve-ordered grid, are under-represented
+        long long offset = static_cast<long long>(rng.below(length));
+        int head = static_cast<int>(std::min<long long>(window, length - offset));
+        buffers[w].resize(window);
+        {
+            TraceSpan span("read", k, window);
+            read(offset, head, buffers[w].data(), w);
+            if (head < window) {
+                read(0, window - head, buffers[w].data() + head, w);
+            }
+        }
+
+        TraceSpan span("cid", k, window);
+        std::vector<CompressionStats> curve;
+        CompressionStats stats = compute_cid(buffers[w].data(), window, workspaces[w],
+                                             curve_options, &curve);
+        curves[k].resize(curve.size());
+        for (size_t c = 0; c < curve.size(); c++) {
+            curves[k][c] = curve[c].factors;
+        }
+        window_cids[k] = stats.cid;
+        done[k] = 1;
+    });
+
+    std::vector<int> picks;
+    double window_cid = 0.0;
+    for (int k = 0; k < samples; k++) {
+        if (done[k]) {
+            picks.push_back(k);
+            window_cid += window_cids[k];
+        }
+    }
+
+    SampledEstimate result;
+    result.length = length;
+    result.samples = picks.size();
+    result.window = window;
+    result.window_cid = window_cid / picks.size();
+    result.cid = extrapolate(checkpoints, curves, picks, length, true,
+                             &result.rate, &result.factors);
+    double windowed = extrapolate(checkpoints, curves, picks, length, false,
+                                     nullptr, nullptr);
+
+    // Percentile bootstrap over the windows, of the fitted estimate and of
+    // the window-by-window bound
+    std::vector<double> fitted(1, result.cid);
+    std::vector<double> flat(1, windowed);
+    if (picks.size() > 1) {
+        fitted.clear();
+        flat.clear();
+        Rng rng(sample.seed ^ (0xb007ULL << 48));
+        std::vector<int> resample(picks.size());
+        for (int b = 0; b < sample.bootstrap; b++) {
+            for (auto& k : resample) {
+                k = picks[rng.below(picks.size())];
+            }
+            fitted.push_back(extrapolate(checkpoints, curves, resample, length, true,
+                                         nullptr, nullptr));
+            flat.push_back(extrapolate(checkpoints, curves, resample, length, false,
+                                       nullptr, nullptr));
+        }
+    }
+    std::sort(fitted.begin(), fitted.end());
+    std::sort(flat.begin(), flat.end());
+    double tail = (1.0 - sample.confidence) / 2.0;
+    size_t last = fitted.size() - 1;
+    size_t low = static_cast<size_t>(std::floor(tail * last));
+    size_t high = static_cast<size_t>(std::ceil((1.0 - tail) * last));
+    result.sampling_low = std::min(result.cid, fitted[low]);
+    result.sampling_high = std::max(result.cid, fitted[high]);
+    // The fit may converge too fast or too slowly, or not describe the
+    // input at all (sparse grids, where phrases grow with the particle
+    // count rather than as n / log n); the windowed parse bounds it above
+    result.cid_low = result.sampling_low;
+    result.cid_high = std::max(result.sampling_high, flat[high]);
+
+    result.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time).count();
+    return result;
+}
+
+}  // namespace
+
+SampledEstimate estimate_cid(const std::string& filename, const SampleOptions& sample,
+                             int n_threads, const CidOptions& options) {
+    std::ifstream probe(filename, std::ios::binary | std::ios::ate);
+    if (!probe) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    long long length = probe.tellg();
+
+    // One stream per worker, opened on first use
+    std::vector<std::unique_ptr<std::ifstream>> streams(
+        resolve_threads(n_threads, sample.samples));
+    auto read = [&](long long offset, int count, unsigned char* out, int w) {
+        if (!streams[w]) {
+            streams[w].reset(new std::ifstream(filename, std::ios::binary));
+        }
+        streams[w]->seekg(offset);
+        streams[w]->read(reinterpret_cast<char*>(out), count);
+        if (!*streams[w]) {
+            throw std::runtime_error("Cannot read window from file: " + filename);
+        }
+    };
+    return estimate(length, read, sample, n_threads, options);
+}
+
+SampledEstimate estimate_cid(const unsigned char* text, long long length,
+                             const SampleOptions& sample, int n_threads,
+                             const CidOptions& options) {
+    auto read = [&](long long offset, int count, unsigned char* out, int) {
+        std::copy(text + offset, text + offset + count, out);
+    };
+    return estimate(length, read, sample, n_threads, options);
+}
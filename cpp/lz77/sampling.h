@@ -0,0 +1,55 @@
+// sampling.h - Approximate CID of very large inputs from sampled windows
+// Factorizes randomly placed contiguous windows (pieces of the Hilbert
+// curve, wrapping around its end so every position is sampled alike), fits how the LZ77 rate estimate z log2(n) / n converges with
+// prefix length inside them and extrapolates it to the whole input. Only
+// the windows are read, so memory stays O(threads * window) whatever the
+// input size.
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cstdint>
+#include <string>
+
+#include "lz77.h"
+
+struct SampleOptions {
+    int samples = 32;            // windows to factorize (upper bound with a budget)
+    int window = 1 << 20;        // symbols per window
+    double time_budget = 0.0;    // seconds; stop drawing windows after it (0 = none)
+    uint64_t seed = 0;
+    int bootstrap = 200;         // resamples for the intervals
+    double confidence = 0.95;
+};
+
+struct SampledEstimate {
+    long long length;     // symbols in the whole input
+    int samples;          // windows actually factorized
+    int window;
+    double rate;          // fitted z log2(n) / n at the full length
+    double factors;       // extrapolated phrase count of the whole input
+    double cid;           // KKP estimate from the extrapolated phrase count
+    // Interval of the whole-input CID: from the bootstrap low of cid over
+    // resampled windows to the bootstrap high of the input costed window by
+    // window at the windows' phrase density, which bounds the error of the
+    // rate fit and its extrapolation from above.
+    double cid_low;
+    double cid_high;
+    // Bootstrap interval of cid over resampled windows alone, the fit held
+    // fixed: the spread from the choice of windows, without model error
+    double sampling_low;
+    double sampling_high;
+    double window_cid;    // mean CID of the windows themselves
+    double seconds;
+};
+
+// Estimate the CID of a file without reading all of it
+SampledEstimate estimate_cid(const std::string& filename, const SampleOptions& sample,
+                             int n_threads, const CidOptions& options = CidOptions());
+
+// Same for a buffer in memory
+SampledEstimate estimate_cid(const unsigned char* text, long long length,
+                             const SampleOptions& sample, int n_threads,
+                             const CidOptions& options = CidOptions());
+
+#endif // SAMPLING_H
@@ -0,0 +1,159 @@
+// shuffle.cpp - Shuffled baselines (null models) for normalizing CID
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "dispatch.h"
+#include "parallel.h"
+#include "profile.h"
+#include "shuffle.h"
+#include "topology.h"
+#include "trace.h"
+
+NullModelSpec parse_null_model(const std::string& spec) {
+    std::string name = spec.substr(0, spec.find(':'));
+    int level = 0;
+    if (spec.find(':') != std::string::npos) {
+        level = std::stoi(spec.substr(spec.find(':') + 1));
+    }
+
+    if (name == "perm") {
+        return {NULL_PERMUTATION, 0};
+    }
+    if (level < 0 || level > 30) {
+        throw std::runtime_error("Null model level out of range: " + spec);
+    }
+    if (name == "block") {
+        return {NULL_BLOCK, level};
+    }
+    if (name == "density") {
+        if (level > 10) {
+            throw std::runtime_error("Null model level out of range: " + spec);
+        }
+        return {NULL_DENSITY, level};
+    }
+    throw std::runtime_error("Unknown null model: " + spec);
+}
+
+std::string null_model_name(const NullModelSpec& spec) {
+    switch (spec.model) {
+        case NULL_BLOCK: return "block:" + std::to_string(spec.level);
+        case NULL_DENSITY: return "density:" + std::to_string(spec.level);
+        default: return "perm";
+    }
+}
+
+uint64_t baseline_seed(uint64_t seed, const NullModelSpec& spec, int replicate) {
+    Rng mix(seed ^ (static_cast<uint64_t>(spec.model) << 56)
+                 ^ (static_cast<uint64_t>(spec.level) << 48)
+                 ^ static_cast<uint64_t>(replicate));
+    return mix.next();
+}
+
+namespace {
+
+HOT_KERNEL void permute(unsigned char* data, int length, Rng& rng) {
+    for (int i = length - 1; i > 0; i--) {
+        std::swap(data[i], data[rng.below(i + 1)]);
+    }
+}
+
+// Blocks are moved whole; a partial tail block stays at the end
+void permute_blocks(const unsigned char* text, int length, int block, Rng& rng,
+                    unsigned char* out) {
+    int num_blocks = length / block;
+    std::vector<int> order(num_blocks);
+    for (int b = 0; b < num_blocks; b++) {
+        order[b] = b;
+    }
+    for (int b = num_blocks - 1; b > 0; b--) {
+        std::swap(order[b], order[rng.below(b + 1)]);
+    }
+    for (int b = 0; b < num_blocks; b++) {
+        std::copy(text + static_cast<long>(order[b]) * block,
+                  text + static_cast<long>(order[b] + 1) * block,
+                  out + static_cast<long>(b) * block);
+    }
+    std::copy(text + static_cast<long>(num_blocks) * block, text + length,
+              out + static_cast<long>(num_blocks) * block);
+}
+
+HOT_KERNEL void redistribute_particles(const unsigned char* text, int length, int cells,
+                                       Rng& rng, unsigned char* out) {
+    if (length % cells != 0) {
+        throw std::runtime_error("Density null model needs one symbol per cell and a "
+                                 "length divisible by the super-cell size");
+    }
+    std::vector<int> counts(cells);
+    for (int start = 0; start < length; start += cells) {
+        long particles = 0;
+        for (int c = 0; c < cells; c++) {
+            if (text[start + c] < '0') {
+                throw std::runtime_error("Density null model needs symbols '0' + count");
+            }
+            particles += text[start + c] - '0';
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+        for (long p = 0; p < particles; p++) {
+            counts[rng.below(cells)]++;
+        }
+        for (int c = 0; c < cells; c++) {
+            if (counts[c] > 255 - '0') {
+                throw std::runtime_error("Cell count too large for one symbol");
+            }
+            out[start + c] = static_cast<unsigned char>('0' + counts[c]);
+        }
+    }
+}
+
+}  // namespace
+
+void apply_null_model(const unsigned char* text, int length, const NullModelSpec& spec,
+                      uint64_t seed, unsigned char* out) {
+    Rng rng(seed);
+    switch (spec.model) {
+        case NULL_BLOCK:
+            permute_blocks(text, length, 1 << spec.level, rng, out);
+            break;
+        case NULL_DENSITY:
+            redistribute_particles(text, length, 1 << (3 * spec.level), rng, out);
+            break;
+        default:
+            std::copy(text, text + length, out);
+            permute(out, length, rng);
+            break;
+    }
+}
+
+std::vector<BaselineResult> compute_baselines(const unsigned char* text, int length,
+                                              const std::vector<NullModelSpec>& specs,
+                                              int n_shuffles, uint64_t seed, int n_threads,
+                                              const CidOptions& options) {
+    PROFILE_PHASE("shuffles");
+    std::vector<BaselineResult> results;
+    for (const auto& spec : specs) {
+        for (int r = 0; r < n_shuffles; r++) {
+            results.push_back({spec, r, CompressionStats()});
+        }
+    }
+
+    // Each worker keeps its own workspace and shuffle buffer for all the
+    // jobs it runs, allocated on its NUMA node (see topology.h)
+    int n_workers = resolve_threads(n_threads, results.size());
+    std::vector<Workspace> workspaces(n_workers);
+    std::vector<std::vector<unsigned char>> buffers(n_workers);
+    numa_parallel_for(results.size(), n_workers, [&](size_t job, int w) {
+        BaselineResult& result = results[job];
+        buffers[w].resize(length);
+        {
+            TraceSpan span("shuffle", job, length);
+            apply_null_model(text, length, result.spec,
+                             baseline_seed(seed, result.spec, result.replicate),
+                             buffers[w].data());
+        }
+        TraceSpan span("cid", job, length);
+        result.stats = compute_cid(buffers[w].data(), length, workspaces[w], options);
+    });
+
+    return results;
+}
@@ -0,0 +1,86 @@
+// shuffle.h - Shuffled baselines (null models) for normalizing CID
+// The symbol buffer is taken to be in Hilbert order, so an aligned block of
+// 2^k symbols is a contiguous piece of the curve and an aligned block of
+// 8^k cells is a cubic super-cell of side 2^k.
+
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lz77.h"
+
+enum NullModel {
+    NULL_PERMUTATION,  // uniform random permutation of all symbols
+    NULL_BLOCK,        // permute the order of blocks of 2^level symbols
+    NULL_DENSITY       // redistribute the particles of every super-cell of
+                       // 8^level cells uniformly among its cells
+};
+
+struct NullModelSpec {
+    NullModel model;
+    int level;
+};
+
+// One baseline CID: null model, replicate index and its stats
+struct BaselineResult {
+    NullModelSpec spec;
+    int replicate;
+    CompressionStats stats;
+};
+
+// Small deterministic generator (SplitMix64) so baselines are reproducible
+// from a seed independently of the standard library.
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform integer in [0, n), unbiased (Lemire)
+    uint64_t below(uint64_t n) {
+        unsigned __int128 m = static_cast<unsigned __int128>(next()) * n;
+        uint64_t low = static_cast<uint64_t>(m);
+        if (low < n) {
+            uint64_t threshold = -n % n;
+            while (low < threshold) {
+                m = static_cast<unsigned __int128>(next()) * n;
+                low = static_cast<uint64_t>(m);
+            }
+        }
+        return static_cast<uint64_t>(m >> 64);
+    }
+
+private:
+    uint64_t state_;
+};
+
+// "perm", "block:K" or "density:K"
+NullModelSpec parse_null_model(const std::string& spec);
+std::string null_model_name(const NullModelSpec& spec);
+
+// Seed of one baseline, a function of the base seed, model and replicate only
+uint64_t baseline_seed(uint64_t seed, const NullModelSpec& spec, int replicate);
+
+// Write a randomized copy of text to out (length bytes). The density model
+// reads each symbol as a cell count '0' + count and writes counts the same
+// way, so it needs one symbol per cell and length divisible by 8^level.
+void apply_null_model(const unsigned char* text, int length, const NullModelSpec& spec,
+                      uint64_t seed, unsigned char* out);
+
+// CID of n_shuffles replicates of every null model, on n_threads threads
+// (0 = all cores). Results are ordered by model, then replicate, and do not
+// depend on the thread count.
+std::vector<BaselineResult> compute_baselines(const unsigned char* text, int length,
+                                              const std::vector<NullModelSpec>& specs,
+                                              int n_shuffles, uint64_t seed, int n_threads,
+                                              const CidOptions& options = CidOptions());
+
+#endif // SHUFFLE_H
@@ -0,0 +1,225 @@
+// streaming.cpp - Window-bounded LZ77 over a stream in O(W) memory
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "dispatch.h"
+#include "streaming.h"
+
+namespace {
+
+const int HASH_BITS = 16;
+
+inline unsigned hash3(unsigned char a, unsigned char b, unsigned char c) {
+    unsigned key = (static_cast<unsigned>(a) << 16) | (static_cast<unsigned>(b) << 8) | c;
+    return (key * 2654435761u) >> (32 - HASH_BITS);
+}
+
+}  // namespace
+
+StreamingParser::StreamingParser(const StreamOptions& options)
+    : window_(options.window),
+      max_chain_(options.max_chain),
+      head_(1 << HASH_BITS, -1),
+      chain_(options.window > 0 ? options.window : 0, -1),
+      last1_(1 << 8, -1),
+      last2_(1 << 16, -1),
+      before2_(1 << 16, -1) {
+    if (window_ < 16) {
+        throw std::runtime_error("Stream window must be at least 16 symbols");
+    }
+    if (max_chain_ < 0) {
+        throw std::runtime_error("Hash-chain limit must be >= 0");
+    }
+    // W symbols of history, W of lookahead and room for W more
+    buffer_.resize(3 * static_cast<size_t>(window_));
+    fixed_len_ = fixed_phrase_bits(window_);
+}
+
+void StreamingParser::set_checkpoints(int min_prefix, double ratio) {
+    if (min_prefix < 1 || ratio <= 1.0) {
+        throw std::runtime_error("Checkpoints need min prefix >= 1 and ratio > 1");
+    }
+    next_checkpoint_ = min_prefix;
+    ratio_ = ratio;
+}
+
+std::vector<std::pair<long long, ParseResult>> StreamingParser::take_snapshots() {
+    std::vector<std::pair<long long, ParseResult>> snapshots;
+    snapshots.swap(snapshots_);
+    return snapshots;
+}
+
+void StreamingParser::append(const unsigned char* data, size_t count) {
+    if (finished_) {
+        throw std::runtime_error("Stream already finished");
+    }
+    while (count > 0) {
+        size_t used = end_ - base_;
+        if (used == buffer_.size()) {
+            // Drop everything before the window of the earliest cursor
+            long long keep = std::max(base_, std::min(next_[0], next_[1]) - window_);
+            std::memmove(buffer_.data(), buffer_.data() + (keep - base_), end_ - keep);
+            base_ = keep;
+            used = end_ - base_;
+        }
+        size_t n = std::min(count, buffer_.size() - used);
+        std::memcpy(buffer_.data() + used, data, n);
+        end_ += n;
+        data += n;
+        count -= n;
+        parse_until(end_ - window_);
+    }
+}
+
+void StreamingParser::finish() {
+    if (!finished_) {
+        parse_until(end_);
+        finished_ = true;
+    }
+}
+
+void StreamingParser::insert_until(long long i) {
+    for (long long p = inserted_; p < i; p++) {
+        unsigned char a = at(p);
+        last1_[a] = p;
+        if (p + 1 < end_) {
+            unsigned pair = (static_cast<unsigned>(a) << 8) | at(p + 1);
+            before2_[pair] = last2_[pair];
+            last2_[pair] = p;
+        }
+        if (p + 2 < end_) {
+            unsigned h = hash3(a, at(p + 1), at(p + 2));
+            chain_[p % window_] = head_[h];
+            head_[h] = p;
+        }
+    }
+    inserted_ = std::max(inserted_, i);
+}
+
+HOT_KERNEL long long StreamingParser::find_match(ParseVariant variant, long long i,
+                                      long long& src) const {
+    long long limit = std::min<long long>(window_, end_ - i);
+    long long lowest = i - window_;
+    long long best = 0;
+
+    // Chain positions decrease and stay valid down to i - W: the slot of a
+    // position p is only reused by p + W, which is not inserted yet
+    if (limit >= 3) {
+        long long c = head_[hash3(at(i), at(i + 1), at(i + 2))];
+        int tries = 0;
+        while (c >= 0 && c >= lowest) {
+            if (max_chain_ > 0 && tries++ == max_chain_) {
+                break;
+            }
+            long long cap = variant == NON_OVERLAPPING ? std::min(limit, i - c) : limit;
+            // A longer match must agree at position best, so check it first
+            if (cap > best && at(c + best) == at(i + best)) {
+                long long len = 0;
+                while (len < cap && at(c + len) == at(i + len)) {
+                    len++;
+                }
+                if (len > best) {
+                    best = len;
+                    src = c;
+                    if (best == limit) {
+                        break;
+                    }
+                }
+            }
+            long long next = chain_[c % window_];
+            if (next >= c) {
+                break;
+            }
+            c = next;
+        }
+    }
+
+    // Shorter matches from the latest occurrence that fits the variant
+    if (best < 2 && limit >= 2) {
+        unsigned pair = (static_cast<unsigned>(at(i)) << 8) | at(i + 1);
+        long long c = last2_[pair];
+        if (variant == NON_OVERLAPPING && c > i - 2) {
+            c = before2_[pair];
+        }
+        if (c >= 0 && c >= lowest) {
+            best = 2;
+            src = c;
+        }
+    }
+    if (best < 1) {
+        long long c = last1_[at(i)];
+        if (c >= 0 && c >= lowest) {
+            best = 1;
+            src = c;
+        }
+    }
+    return best;
+}
+
+void StreamingParser::parse_until(long long limit_end) {
+    while (true) {
+        long long i = std::min(next_[NON_OVERLAPPING], next_[OVERLAPPING]);
+
+        // Phrases of either variant that start before a checkpoint have all
+        // been added once both cursors are past it
+        while (ratio_ > 0 && static_cast<long long>(next_checkpoint_) <= i &&
+               static_cast<long long>(next_checkpoint_) < end_) {
+            long long cp = static_cast<long long>(next_checkpoint_);
+            if (snapshots_.empty() || cp > last_checkpoint_) {
+                snapshots_.emplace_back(cp, result_);
+                last_checkpoint_ = cp;
+            }
+            next_checkpoint_ *= ratio_;
+        }
+        if (i >= end_ || i > limit_end) {
+            break;
+        }
+
+        insert_until(i);
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            if (next_[v] == i) {
+                long long src = i;
+                long long len = find_match(static_cast<ParseVariant>(v), i, src);
+                add_phrase(result_.variant[v], len, i - src, fixed_len_);
+                next_[v] = i + std::max(len, 1LL);
+            }
+        }
+    }
+}
+
+CompressionStats compute_streaming_cid(
+    std::istream& in, const StreamOptions& stream, const CidOptions& options,
+    const std::function<void(const CompressionStats&)>& on_prefix) {
+    StreamingParser parser(stream);
+    if (on_prefix) {
+        parser.set_checkpoints(options.min_prefix, options.ratio);
+    }
+
+    auto report = [&]() {
+        for (const auto& snapshot : parser.take_snapshots()) {
+            on_prefix(make_stats(snapshot.second, snapshot.first, options));
+        }
+    };
+
+    std::vector<char> chunk(1 << 16);
+    while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0) {
+        parser.append(reinterpret_cast<const unsigned char*>(chunk.data()), in.gcount());
+        if (on_prefix) {
+            report();
+        }
+    }
+    if (in.bad()) {
+        throw std::runtime_error("Cannot read input stream");
+    }
+    parser.finish();
+    if (on_prefix) {
+        report();
+    }
+
+    if (parser.length() == 0) {
+        throw std::runtime_error("Empty input");
+    }
+    return make_stats(parser.parse(), parser.length(), options);
+}
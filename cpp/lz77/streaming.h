@@ -0,0 +1,93 @@
+// streaming.h - Window-bounded LZ77 over a stream in O(W) memory
+// As in real compressors, a phrase copies from a source at most W symbols
+// back and is at most W symbols long, so the parse measures local rather
+// than global repetitiveness. Input is appended in chunks of any size and
+// parsed as soon as W symbols of lookahead are available; only the last W
+// symbols, the lookahead and a hash chain over the window are kept.
+
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <functional>
+#include <istream>
+#include <utility>
+#include <vector>
+
+#include "lz77.h"
+
+struct StreamOptions {
+    int window = 1 << 15;   // maximum offset and phrase length
+    int max_chain = 0;      // hash-chain candidates tried per phrase (0 = all, exact)
+};
+
+// Greedy parse of both variants (see ParseVariant) in one pass. Matches of
+// 3 symbols or more are found by walking a chain of earlier positions with
+// the same 3-symbol hash; shorter matches come from the last occurrence of
+// each 1- and 2-symbol string. With max_chain = 0 every phrase is the
+// longest match within the window.
+class StreamingParser {
+public:
+    explicit StreamingParser(const StreamOptions& options = StreamOptions());
+
+    // Append count symbols and parse everything that has W symbols of
+    // lookahead
+    void append(const unsigned char* data, size_t count);
+
+    // Parse the remaining lookahead; no symbols may be appended afterwards
+    void finish();
+
+    // Symbols appended so far
+    long long length() const { return end_; }
+
+    // Phrases of both variants so far
+    const ParseResult& parse() const { return result_; }
+
+    // Record the parse of each prefix min_prefix, min_prefix * ratio, ...
+    // (phrases starting before it) as the stream passes it
+    void set_checkpoints(int min_prefix, double ratio);
+
+    // Prefix parses recorded since the last call, in increasing length
+    std::vector<std::pair<long long, ParseResult>> take_snapshots();
+
+private:
+    unsigned char at(long long p) const { return buffer_[p - base_]; }
+    void parse_until(long long limit_end);
+    void insert_until(long long i);
+    long long find_match(ParseVariant variant, long long i, long long& src) const;
+
+    int window_;
+    int max_chain_;
+    bool finished_ = false;
+
+    // Symbols [base_, end_) of the stream
+    std::vector<unsigned char> buffer_;
+    long long base_ = 0;
+    long long end_ = 0;
+
+    long long next_[NUM_VARIANTS] = {0, 0};  // start of the next phrase of each variant
+    long long inserted_ = 0;                 // positions < inserted_ are in the tables
+
+    std::vector<long long> head_;      // latest position of each 3-symbol hash
+    std::vector<long long> chain_;     // previous position with the same hash, by p % W
+    std::vector<long long> last1_;     // latest position of each symbol
+    std::vector<long long> last2_;     // latest position of each symbol pair
+    std::vector<long long> before2_;   // and the one before it
+
+    ParseResult result_ = {};
+    int fixed_len_;
+
+    double next_checkpoint_ = 0.0;
+    double ratio_ = 0.0;
+    long long last_checkpoint_ = 0;
+    std::vector<std::pair<long long, ParseResult>> snapshots_;
+};
+
+// Window-bounded CID of a whole stream, read in chunks. If on_prefix is
+// given it is called with the stats of every geometric prefix shorter than
+// the stream (see geometric_checkpoints) as soon as the parse has passed
+// it, so a long-running stream can be monitored.
+CompressionStats compute_streaming_cid(
+    std::istream& in, const StreamOptions& stream, const CidOptions& options = CidOptions(),
+    const std::function<void(const CompressionStats&)>& on_prefix = nullptr);
+
+#endif // STREAMING_H
@@ -0,0 +1,111 @@
+// topology.cpp - NUMA node layout from sysfs and thread pinning
+
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+
+#include "topology.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.find_first_not_of(" \t\n") == std::string::npos) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> thread_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+bool pin_thread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+std::vector<NumaNode> numa_topology(const std::string& root) {
+    std::vector<NumaNode> nodes;
+    DIR* dir = opendir(root.c_str());
+    if (!dir) {
+        return nodes;
+    }
+    // CPUs outside the affinity mask (taskset, cgroup cpusets) are dropped
+    std::vector<int> allowed = thread_cpus();
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+            name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+        std::ifstream list(root + "/" + name + "/cpulist");
+        std::string text;
+        std::getline(list, text);
+        NumaNode node = {std::stoi(name.substr(4)), {}};
+        for (int cpu : parse_cpu_list(text)) {
+            if (allowed.empty() || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty()) {
+            nodes.push_back(node);
+        }
+    }
+    closedir(dir);
+    std::sort(nodes.begin(), nodes.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return nodes;
+}
+
+std::vector<int> place_workers(const std::vector<NumaNode>& nodes, int n_workers) {
+    std::vector<int> worker_node;
+    if (nodes.size() < 2) {
+        return worker_node;
+    }
+    for (int w = 0; w < n_workers; w++) {
+        worker_node.push_back(w % nodes.size());
+    }
+    return worker_node;
+}
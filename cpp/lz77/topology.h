@@ -0,0 +1,110 @@
+// topology.h - NUMA node layout and node-local worker placement
+// The node layout is read from sysfs (/sys/devices/system/node), so no
+// NUMA library is needed. Workers of a placed parallel_for are spread
+// round-robin over the nodes and pinned to their node's CPUs; since a
+// worker resizes its own Workspace, the kernel's first-touch policy then
+// puts the suffix-array buffers on the node that reads them. Each node
+// works through its own share of the jobs first and only then helps the
+// others, so rows stay node-local until the end of the batch.
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;   // online CPUs of the node this process may use
+};
+
+// "0-3,8,10-11" -> 0 1 2 3 8 10 11
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// Nodes with at least one usable CPU, by id; empty if sysfs has no node
+// directory (non-Linux, or a kernel without NUMA)
+std::vector<NumaNode> numa_topology(const std::string& root = "/sys/devices/system/node");
+
+// Restrict the calling thread to cpus; returns false (and leaves it
+// unpinned) where that is not supported or not permitted
+bool pin_thread(const std::vector<int>& cpus);
+
+// CPUs the calling thread may run on now, empty if unknown
+std::vector<int> thread_cpus();
+
+// Node of each of n_workers workers, round-robin over nodes; empty (no
+// placement) with fewer than two nodes
+std::vector<int> place_workers(const std::vector<NumaNode>& nodes, int n_workers);
+
+// parallel_for with workers pinned per NUMA node and the jobs split into
+// one contiguous share per node, in proportion to its workers. Falls back
+// to parallel_for on single-node machines. The calling thread (worker 0)
+// gets its original CPU set back at the end.
+template <typename Job>
+void numa_parallel_for(size_t n_jobs, int n_workers, Job job,
+                       const std::vector<NumaNode>& nodes = numa_topology()) {
+    std::vector<int> worker_node = place_workers(nodes, n_workers);
+    if (worker_node.empty()) {
+        parallel_for(n_jobs, n_workers, job);
+        return;
+    }
+
+    int n_nodes = nodes.size();
+    std::vector<int> node_workers(n_nodes, 0);
+    for (int node : worker_node) {
+        node_workers[node]++;
+    }
+    std::vector<size_t> share_begin(n_nodes + 1, 0);
+    for (int k = 0, seen = 0; k < n_nodes; k++) {
+        seen += node_workers[k];
+        share_begin[k + 1] = n_jobs * seen / n_workers;
+    }
+    std::vector<std::atomic<size_t>> next_job(n_nodes);
+    for (int k = 0; k < n_nodes; k++) {
+        next_job[k] = share_begin[k];
+    }
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> errors(n_workers);
+
+    auto worker = [&](int w) {
+        try {
+            pin_thread(nodes[worker_node[w]].cpus);
+            // Own node first, then help the others in turn
+            for (int step = 0; step < n_nodes && !failed; step++) {
+                int k = (worker_node[w] + step) % n_nodes;
+                for (size_t index = next_job[k]++; index < share_begin[k + 1] && !failed;
+                     index = next_job[k]++) {
+                    job(index, w);
+                }
+            }
+        } catch (...) {
+            errors[w] = std::current_exception();
+            failed = true;
+        }
+    };
+
+    std::vector<int> original = thread_cpus();
+    std::vector<std::thread> threads;
+    for (int w = 1; w < n_workers; w++) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!original.empty()) {
+        pin_thread(original);
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,121 @@
+// trace.cpp - Per-thread task timeline written as Chrome trace JSON
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "trace.h"
+
+std::atomic<bool> trace_on(false);
+
+namespace {
+
+struct TraceEvent {
+    const char* stage;
+    long long item;
+    long long size;
+    long long begin;
+    long long end;
+};
+
+// Buffers outlive their threads, so workers of a finished parallel_for
+// still show up when the trace is written
+struct ThreadBuffer {
+    int tid;
+    std::vector<TraceEvent> events;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::string filename;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// The calling thread's buffer, registered (under the lock) on first use
+ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.emplace_back(new ThreadBuffer());
+        buffer = r.buffers.back().get();
+        buffer->tid = r.buffers.size();
+        buffer->events.reserve(4096);
+    }
+    return *buffer;
+}
+
+void write_at_exit() {
+    try {
+        trace_write(registry().filename);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+    }
+}
+
+}  // namespace
+
+void trace_start(const std::string& filename) {
+    Registry& r = registry();
+    bool first = r.filename.empty();
+    r.filename = filename;
+    r.origin = std::chrono::steady_clock::now();
+    if (first) {
+        std::atexit(write_at_exit);
+    }
+    trace_on = true;
+}
+
+long long trace_clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().origin).count();
+}
+
+void trace_record(const char* stage, long long item, long long size, long long begin,
+                  long long end) {
+    thread_buffer().events.push_back({stage, item, size, begin, end});
+}
+
+void trace_write(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // Complete ("X") events in microseconds, one track per thread; thread 1
+    // is the first to record, normally the main thread
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": "
+        << "\"lz_entropy\"}}";
+    char line[256];
+    for (const auto& buffer : r.buffers) {
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << buffer->tid << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        for (const auto& e : buffer->events) {
+            std::snprintf(line, sizeof(line),
+                          ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                          "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"item\": %lld, "
+                          "\"size\": %lld}}",
+                          e.stage, buffer->tid, e.begin / 1000.0, (e.end - e.begin) / 1000.0,
+                          e.item, e.size);
+            out << line;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+}
@@ -0,0 +1,61 @@
+// trace.h - Timeline of the tasks run by the batch and pipeline executors
+// Each task (reading a frame, sorting a segment, the CID of a row, a
+// shuffle) opens a TraceSpan; when tracing is on, its begin/end time, thread,
+// item (frame, row or replicate index) and size are appended to a buffer
+// owned by the calling thread, so recording never takes a lock. The buffers
+// are written as Chrome trace JSON, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open directly. When tracing is off a span costs one
+// relaxed atomic load.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+extern std::atomic<bool> trace_on;
+
+inline bool trace_enabled() {
+    return trace_on.load(std::memory_order_relaxed);
+}
+
+// Start recording; the trace is written to filename at exit
+void trace_start(const std::string& filename);
+
+// Write the events recorded so far (all threads must be idle)
+void trace_write(const std::string& filename);
+
+// Nanoseconds since the trace started
+long long trace_clock();
+
+void trace_record(const char* stage, long long item, long long size, long long begin,
+                  long long end);
+
+class TraceSpan {
+public:
+    TraceSpan(const char* stage, long long item, long long size)
+        : stage_(trace_enabled() ? stage : nullptr),
+          item_(item),
+          size_(size),
+          begin_(stage_ ? trace_clock() : 0) {}
+
+    ~TraceSpan() {
+        if (stage_) {
+            trace_record(stage_, item_, size_, begin_, trace_clock());
+        }
+    }
+
+    // For tasks whose size is only known once they ran (e.g. a file read)
+    void set_size(long long size) { size_ = size; }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* stage_;   // nullptr when tracing is off
+    long long item_;
+    long long size_;
+    long long begin_;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,93 @@
+// trajectory.cpp - CID of sliding windows of consecutive frames
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "trace.h"
+#include "trajectory.h"
+
+std::vector<WindowResult> compute_windowed_cid(const std::vector<std::string>& frames,
+                                               int window, int stride, int n_threads,
+                                               const CidOptions& options) {
+    int num_frames = frames.size();
+    if (window < 1 || stride < 1) {
+        throw std::runtime_error("Window and stride must be at least 1 frame");
+    }
+    if (window > num_frames) {
+        throw std::runtime_error("Window is longer than the trajectory");
+    }
+
+    // The whole trajectory, frame after frame
+    std::vector<long> offset(num_frames + 1, 0);
+    for (int f = 0; f < num_frames; f++) {
+        offset[f + 1] = offset[f] + frames[f].length();
+    }
+    if (offset[num_frames] > 0x7fffffffL) {
+        throw std::runtime_error("Trajectory longer than 2^31 symbols");
+    }
+    std::string trajectory;
+    trajectory.reserve(offset[num_frames]);
+    for (const auto& frame : frames) {
+        trajectory += frame;
+    }
+    const unsigned char* text = reinterpret_cast<const unsigned char*>(trajectory.data());
+
+    std::vector<WindowResult> results;
+    for (int first = 0; first + window <= num_frames; first += stride) {
+        results.push_back({first, CompressionStats()});
+    }
+
+    int per_group = (window + stride - 1) / stride;
+    size_t num_groups = (results.size() + per_group - 1) / per_group;
+
+    int n_workers = resolve_threads(n_threads, num_groups);
+    std::vector<Workspace> segment_ws(n_workers);
+    std::vector<Workspace> window_ws(n_workers);
+
+    parallel_for(num_groups, n_workers, [&](size_t group, int w) {
+        size_t begin = group * per_group;
+        size_t end = std::min(results.size(), begin + per_group);
+        long seg_start = offset[results[begin].first_frame];
+        long seg_end = offset[results[end - 1].first_frame + window];
+        int seg_length = seg_end - seg_start;
+        if (seg_length == 0) {
+            throw std::runtime_error("Empty window");
+        }
+
+        Workspace& seg = segment_ws[w];
+        {
+            TraceSpan span("sa", results[begin].first_frame, seg_length);
+            build_suffix_array(text + seg_start, seg_length, seg);
+        }
+
+        Workspace& ws = window_ws[w];
+        for (size_t k = begin; k < end; k++) {
+            int first = results[k].first_frame;
+            int start = offset[first] - seg_start;
+            int length = offset[first + window] - offset[first];
+            if (length == 0) {
+                throw std::runtime_error("Empty window");
+            }
+            TraceSpan span("cid", first, length);
+
+            // Suffixes of the segment starting inside the window, in segment
+            // order. A window suffix may sort differently from its
+            // truncation, but only LCPs with earlier positions are used and
+            // those are capped at the window end anyway.
+            ws.sa.resize(length);
+            int n = 0;
+            for (int r = 0; r < seg_length; r++) {
+                unsigned pos = static_cast<unsigned>(seg.sa[r] - start);
+                if (pos < static_cast<unsigned>(length)) {
+                    ws.sa[n++] = pos;
+                }
+            }
+
+            build_psv_nsv(text + seg_start + start, length, ws);
+            results[k].stats = make_stats(lz77_factorize(length, ws), length, options);
+        }
+    });
+
+    return results;
+}
@@ -0,0 +1,28 @@
+// trajectory.h - CID of sliding windows of consecutive frames
+// A window is the concatenation of the symbol buffers of W consecutive
+// frames; windows start every stride frames.
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <string>
+#include <vector>
+
+#include "lz77.h"
+
+struct WindowResult {
+    int first_frame;
+    CompressionStats stats;
+};
+
+// Windows that start close together share one suffix array, built over the
+// frames spanned by a group of ceil(window / stride) windows (at most
+// 2 * window - 1 frames). Each window then keeps the entries of that suffix
+// array inside its own range, which is a valid suffix order for the
+// PSV/NSV factorizer, so no window is suffix-sorted on its own. Groups run
+// on n_threads threads (0 = all cores).
+std::vector<WindowResult> compute_windowed_cid(const std::vector<std::string>& frames,
+                                               int window, int stride, int n_threads,
+                                               const CidOptions& options = CidOptions());
+
+#endif // TRAJECTORY_H
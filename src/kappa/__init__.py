@@ -4,12 +4,26 @@ kappa asdf
 
 from .lz_entropy import (
     compute_cid,
+    compute_cid_batch,
+    compute_cid_curve,
+    compute_windowed_cid,
+    compute_online_cid,
+    estimate_cid,
+    compute_lpf,
+    compute_mutual_information,
     compute_normalized_cid,
+    compute_null_baselines,
+    compute_type_sequence_cid,
+    compute_key_gap_cid,
     batch_process
 )
 
 from .binning import (
     bin_particles_3d,
+    bin_channels_3d,
+    bin_compositions_3d,
+    bin_sorted_3d,
+    hilbert_sort_particles,
     load_xyz_snapshot
 )
 
@@ -18,13 +32,38 @@ from .lammps_io import (
     filter_by_atom_type
 )
 
+from .pool import (
+    Pool,
+    submit,
+    submit_async,
+    imap
+)
+
 __all__ = [
     'compute_cid',
+    'compute_cid_batch',
+    'compute_cid_curve',
+    'compute_windowed_cid',
+    'compute_online_cid',
+    'estimate_cid',
+    'compute_lpf',
+    'compute_mutual_information',
     'compute_normalized_cid',
+    'compute_null_baselines',
+    'compute_type_sequence_cid',
+    'compute_key_gap_cid',
     'batch_process',
     'bin_particles_3d',
+    'bin_channels_3d',
+    'bin_compositions_3d',
+    'bin_sorted_3d',
+    'hilbert_sort_particles',
     'load_xyz_snapshot',
     'read_lammps_data',
-    'filter_by_atom_type'
+    'filter_by_atom_type',
+    'Pool',
+    'submit',
+    'submit_async',
+    'imap'
 ]
 
@@ -0,0 +1,391 @@
+"""
+In-process access to the C++ engine through libkappa (cpp/lz77/kappa.h).
+
+Arrays are handed to the library by pointer, without copies or temp files,
+and the calls release the GIL (ctypes.CDLL), so they can run on Python
+threads in parallel. Everything here returns None / False when the library
+has not been built; callers then fall back to the lz_entropy executable.
+"""
+
+import ctypes
+from pathlib import Path
+
+import numpy as np
+
+_CPP_DIR = Path(__file__).parent.parent.parent / "cpp" / "lz77"
+_ABI_VERSION = 1
+
+_COSTS = {'kkp': 0, 'gamma': 1, 'delta': 2, 'fixed': 3}
+
+# Same layout as kappa_stats, so results are written straight into numpy
+STATS_DTYPE = np.dtype([('length', np.int64), ('factors', np.int64),
+                        ('compressed_bits', np.float64), ('cid', np.float64)])
+
+
+# Same layout as kappa_particle (int32 type, padding, three doubles)
+PARTICLE_DTYPE = np.dtype({'names': ['type', 'x', 'y', 'z'],
+                           'formats': [np.int32, np.float64, np.float64, np.float64],
+                           'offsets': [0, 8, 16, 24], 'itemsize': 32})
+
+
+class KappaError(RuntimeError):
+    """Failed libkappa call: status code and the library's message."""
+
+    def __init__(self, status, message):
+        super().__init__(f"libkappa error {status}: {message}")
+        self.status = status
+
+
+class _Options(ctypes.Structure):
+    _fields_ = [('overlap', ctypes.c_int32), ('cost', ctypes.c_int32)]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('length', ctypes.c_int64), ('factors', ctypes.c_int64),
+                ('compressed_bits', ctypes.c_double), ('cid', ctypes.c_double)]
+
+
+class _Particle(ctypes.Structure):
+    _fields_ = [('type', ctypes.c_int32), ('x', ctypes.c_double),
+                ('y', ctypes.c_double), ('z', ctypes.c_double)]
+
+
+class _Job(ctypes.Structure):
+    _fields_ = [('input', ctypes.c_int32), ('nbins', ctypes.c_int32),
+                ('box_size', ctypes.c_double), ('one_symbol_per_cell', ctypes.c_int32),
+                ('n_shuffles', ctypes.c_int32), ('seed', ctypes.c_uint64),
+                ('options', _Options)]
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [('id', ctypes.c_int64), ('status', ctypes.c_int32), ('stats', _Stats),
+                ('cid_shuffled', ctypes.c_double), ('cid_shuffled_std', ctypes.c_double),
+                ('seconds', ctypes.c_double), ('error', ctypes.c_char * 256)]
+
+
+INPUT_SYMBOLS, INPUT_XYZ, INPUT_LAMMPS = 0, 1, 2
+
+_lib = None
+_loaded = False
+
+
+def _load():
+    """The library with its signatures declared, or None if not built."""
+    global _lib, _loaded
+    if _loaded:
+        return _lib
+    _loaded = True
+    for name in ('libkappa.so', 'libkappa.dylib'):
+        path = _CPP_DIR / name
+        if not path.exists():
+            continue
+        lib = ctypes.CDLL(str(path))
+        if lib.kappa_abi_version() != _ABI_VERSION:
+            return None
+        p = ctypes.POINTER
+        lib.kappa_last_error.restype = ctypes.c_char_p
+        lib.kappa_workspace_create.restype = ctypes.c_void_p
+        lib.kappa_workspace_destroy.argtypes = [ctypes.c_void_p]
+        lib.kappa_cid.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int64,
+                                  p(_Options), p(_Stats)]
+        lib.kappa_cid_batch.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int64,
+                                        ctypes.c_int32, p(_Options), ctypes.c_void_p,
+                                        ctypes.c_void_p]
+        lib.kappa_baselines.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_char_p,
+                                        ctypes.c_int32, ctypes.c_uint64, ctypes.c_int32,
+                                        p(_Options), ctypes.c_void_p]
+        lib.kappa_read_xyz.argtypes = [ctypes.c_char_p, p(p(_Particle)), p(ctypes.c_int64)]
+        lib.kappa_read_lammps_data.argtypes = [ctypes.c_char_p, p(p(_Particle)),
+                                               p(ctypes.c_int64), p(ctypes.c_double)]
+        lib.kappa_free.argtypes = [ctypes.c_void_p]
+        lib.kappa_bin_particles.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32,
+                                            ctypes.c_double, ctypes.c_int32, ctypes.c_void_p,
+                                            ctypes.c_int64, p(ctypes.c_int64)]
+        lib.kappa_hilbert_sort.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32,
+                                           ctypes.c_double, ctypes.c_int32, ctypes.c_void_p,
+                                           ctypes.c_void_p, ctypes.c_void_p, p(ctypes.c_int64)]
+        lib.kappa_bin_sorted.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32,
+                                         ctypes.c_int32, ctypes.c_int32, ctypes.c_void_p,
+                                         ctypes.c_int64, p(ctypes.c_int64)]
+        lib.kappa_type_sequence.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32,
+                                            ctypes.c_double, ctypes.c_int32, ctypes.c_void_p,
+                                            ctypes.c_int64, p(ctypes.c_int64)]
+        lib.kappa_key_gaps.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32,
+                                       ctypes.c_double, ctypes.c_int32, ctypes.c_int32,
+                                       ctypes.c_void_p, ctypes.c_int64, p(ctypes.c_int64)]
+        lib.kappa_composition_cells.argtypes = [
+            ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32, ctypes.c_double, ctypes.c_int32,
+            ctypes.c_void_p, ctypes.c_int64, p(ctypes.c_int64), p(ctypes.c_int32),
+            ctypes.c_void_p, ctypes.c_int64, p(ctypes.c_int32), ctypes.c_void_p, ctypes.c_int32,
+            p(ctypes.c_int32)]
+        lib.kappa_pool_create.argtypes = [ctypes.c_int32, ctypes.c_int32]
+        lib.kappa_pool_create.restype = ctypes.c_void_p
+        lib.kappa_pool_close.argtypes = [ctypes.c_void_p]
+        lib.kappa_pool_destroy.argtypes = [ctypes.c_void_p]
+        lib.kappa_pool_submit.argtypes = [ctypes.c_void_p, ctypes.c_char_p, p(_Job),
+                                          p(ctypes.c_int64)]
+        lib.kappa_pool_submit_data.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int64,
+                                               p(_Job), p(ctypes.c_int64)]
+        lib.kappa_pool_wait.argtypes = [ctypes.c_void_p, ctypes.c_double, p(_Result)]
+        lib.kappa_pool_wait.restype = ctypes.c_int32
+        lib.kappa_trace_start.argtypes = [ctypes.c_char_p]
+        lib.kappa_trace_write.argtypes = [ctypes.c_char_p]
+        _lib = lib
+        break
+    return _lib
+
+
+def available():
+    """True if libkappa is built and has the expected ABI version."""
+    return _load() is not None
+
+
+def library():
+    """libkappa as a ctypes.CDLL with the kappa.h signatures, or None if not built."""
+    return _load()
+
+
+def _check(status):
+    if status != 0:
+        raise KappaError(status, _lib.kappa_last_error().decode())
+
+
+def _options(overlap, cost):
+    if cost not in _COSTS:
+        raise ValueError(f"Unknown cost model: {cost}")
+    return _Options(1 if overlap else 0, _COSTS[cost])
+
+
+def _as_bytes(data):
+    """uint8 array over data (str, bytes or array), without copying arrays."""
+    if isinstance(data, str):
+        data = data.encode('utf-8')
+    if isinstance(data, (bytes, bytearray)):
+        return np.frombuffer(data, dtype=np.uint8)
+    return np.ascontiguousarray(data, dtype=np.uint8)
+
+
+class Workspace:
+    """Suffix-array buffers reused across cid() calls (one per thread)."""
+
+    def __init__(self):
+        lib = _load()
+        if lib is None:
+            raise RuntimeError("libkappa is not built (cd cpp/lz77 && make)")
+        self._handle = lib.kappa_workspace_create()
+        if not self._handle:
+            raise MemoryError("Cannot allocate workspace")
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _lib.kappa_workspace_destroy(self._handle)
+            self._handle = None
+
+    def cid(self, data, overlap=False, cost='kkp'):
+        """Stats dict (length, factors, compressed_bits, cid) of data."""
+        buffer = _as_bytes(data)
+        stats = _Stats()
+        _check(_lib.kappa_cid(self._handle, buffer.ctypes.data, buffer.size,
+                              ctypes.byref(_options(overlap, cost)), ctypes.byref(stats)))
+        return {'length': stats.length, 'factors': stats.factors,
+                'compressed_bits': stats.compressed_bits, 'cid': stats.cid}
+
+
+def cid_batch(data, offsets, n_threads=0, overlap=False, cost='kkp'):
+    """
+    CID of rows data[offsets[r]:offsets[r + 1]] of one uint8 buffer, read in
+    place. Returns (stats, seconds): a STATS_DTYPE array and the time per
+    row, or None if the library is not built.
+    """
+    if _load() is None:
+        return None
+    data = np.ascontiguousarray(data, dtype=np.uint8).reshape(-1)
+    offsets = np.ascontiguousarray(offsets, dtype=np.int64)
+    n_rows = len(offsets) - 1
+    if n_rows < 0 or offsets[0] != 0 or offsets[-1] != data.size:
+        raise ValueError("Row offsets must run from 0 to the buffer length")
+    stats = np.empty(n_rows, dtype=STATS_DTYPE)
+    seconds = np.empty(n_rows, dtype=np.float64)
+    _check(_lib.kappa_cid_batch(data.ctypes.data, offsets.ctypes.data, n_rows,
+                                n_threads or 0, ctypes.byref(_options(overlap, cost)),
+                                stats.ctypes.data, seconds.ctypes.data))
+    return stats, seconds
+
+
+def baselines(data, null_model='perm', n_shuffles=1, seed=0, n_threads=0, overlap=False,
+              cost='kkp'):
+    """STATS_DTYPE array of n_shuffles shuffled copies of data, or None."""
+    if _load() is None:
+        return None
+    buffer = _as_bytes(data)
+    stats = np.empty(n_shuffles, dtype=STATS_DTYPE)
+    _check(_lib.kappa_baselines(buffer.ctypes.data, buffer.size, null_model.encode(),
+                                n_shuffles, seed, n_threads or 0,
+                                ctypes.byref(_options(overlap, cost)), stats.ctypes.data))
+    return stats
+
+
+def trace_start(path):
+    """
+    Record the read, bin, cid and shuffle tasks of every native thread,
+    written to path as Chrome trace JSON at exit. False if not built.
+    """
+    if _load() is None:
+        return False
+    _check(_lib.kappa_trace_start(str(path).encode()))
+    return True
+
+
+def trace_write(path):
+    """Write the tasks recorded so far to path; no native call may be running."""
+    if _load() is None:
+        return False
+    _check(_lib.kappa_trace_write(str(path).encode()))
+    return True
+
+
+def _to_records(particles):
+    """PARTICLE_DTYPE array of an Nx4 [type, x, y, z] array."""
+    particles = np.asarray(particles, dtype=np.float64).reshape(-1, 4)
+    records = np.empty(len(particles), dtype=PARTICLE_DTYPE)
+    records['type'] = particles[:, 0]
+    records['x'], records['y'], records['z'] = particles[:, 1], particles[:, 2], particles[:, 3]
+    return records
+
+
+def _from_records(records):
+    return np.column_stack([records['type'], records['x'], records['y'],
+                            records['z']]).astype(np.float64)
+
+
+def _read(reader, path, *extra):
+    particles = ctypes.POINTER(_Particle)()
+    count = ctypes.c_int64()
+    _check(reader(str(path).encode(), ctypes.byref(particles), ctypes.byref(count), *extra))
+    try:
+        raw = np.ctypeslib.as_array(ctypes.cast(particles, ctypes.POINTER(ctypes.c_uint8)),
+                                    shape=(count.value * ctypes.sizeof(_Particle),))
+        return _from_records(raw.view(PARTICLE_DTYPE))
+    finally:
+        _lib.kappa_free(particles)
+
+
+def read_xyz(path):
+    """Nx4 [type, x, y, z] array of an xyz snapshot, or None."""
+    if _load() is None:
+        return None
+    return _read(_lib.kappa_read_xyz, path)
+
+
+def read_lammps_data(path):
+    """(Nx4 [type, x, y, z] array, box size) of a LAMMPS data file, or None."""
+    if _load() is None:
+        return None
+    box_size = ctypes.c_double()
+    particles = _read(_lib.kappa_read_lammps_data, path, ctypes.byref(box_size))
+    return particles, box_size.value
+
+
+def _output(call, capacity):
+    """Bytes written by call(out, capacity, length), retried with more room as needed."""
+    while True:
+        out = np.empty(capacity, dtype=np.uint8)
+        length = ctypes.c_int64()
+        status = call(out.ctypes.data, capacity, ctypes.byref(length))
+        if status != 4:   # KAPPA_ERROR_BUFFER_TOO_SMALL
+            _check(status)
+            return out[:length.value].tobytes()
+        capacity = length.value
+
+
+def bin_particles(particles, nbins=32, box_size=75, one_symbol_per_cell=False):
+    """Binned string as bin_particles_3d, computed natively, or None."""
+    if _load() is None:
+        return None
+    records = _to_records(particles)
+    return _output(lambda out, capacity, length: _lib.kappa_bin_particles(
+        records.ctypes.data, len(records), nbins, box_size, 1 if one_symbol_per_cell else 0,
+        out, capacity, length), nbins ** 3 if one_symbol_per_cell else 4 * nbins ** 3
+    ).decode('ascii')
+
+
+def hilbert_sort(particles, box_size=75, level=10, n_threads=0):
+    """
+    (sorted Nx4 particles, uint64 keys, int64 permutation, particles in the
+    box) of particles sorted along the Hilbert curve, or None.
+    """
+    if _load() is None:
+        return None
+    records = _to_records(particles)
+    n = len(records)
+    out = np.empty(n, dtype=PARTICLE_DTYPE)
+    keys = np.empty(n, dtype=np.uint64)
+    permutation = np.empty(n, dtype=np.int64)
+    inside = ctypes.c_int64()
+    _check(_lib.kappa_hilbert_sort(records.ctypes.data, n, level, box_size, n_threads or 0,
+                                   out.ctypes.data, keys.ctypes.data, permutation.ctypes.data,
+                                   ctypes.byref(inside)))
+    return _from_records(out), keys, permutation, inside.value
+
+
+def bin_sorted(keys, level, nbins=32, one_symbol_per_cell=False):
+    """Binned string from the keys of hilbert_sort, or None."""
+    if _load() is None:
+        return None
+    keys = np.ascontiguousarray(keys, dtype=np.uint64)
+    return _output(lambda out, capacity, length: _lib.kappa_bin_sorted(
+        keys.ctypes.data, len(keys), level, nbins, 1 if one_symbol_per_cell else 0,
+        out, capacity, length), nbins ** 3 if one_symbol_per_cell else 4 * nbins ** 3
+    ).decode('ascii')
+
+
+def type_sequence(particles, box_size=75, level=21, n_threads=0):
+    """Type labels of the particles in the box in Hilbert order, or None."""
+    if _load() is None:
+        return None
+    records = _to_records(particles)
+    return _output(lambda out, capacity, length: _lib.kappa_type_sequence(
+        records.ctypes.data, len(records), level, box_size, n_threads or 0, out, capacity,
+        length), max(len(records), 1)).decode('ascii')
+
+
+def key_gaps(particles, box_size=75, level=10, quantize_bits=0, n_threads=0):
+    """Varint stream of the Hilbert key gaps of the particles, or None."""
+    if _load() is None:
+        return None
+    records = _to_records(particles)
+    return _output(lambda out, capacity, length: _lib.kappa_key_gaps(
+        records.ctypes.data, len(records), level, box_size, quantize_bits, n_threads or 0,
+        out, capacity, length), max(10 * len(records), 1))
+
+
+def composition_cells(particles, nbins=32, box_size=75, n_threads=0):
+    """
+    (CID input bytes, uint8 or uint16 symbol per cell, compositions as a
+    (K, n_types) count array, types) of the composition encoding, or None.
+    """
+    if _load() is None:
+        return None
+    records = _to_records(particles)
+    capacity, n_rows, n_columns = nbins ** 3, 256, 16
+    while True:
+        out = np.empty(capacity, dtype=np.uint8)
+        dictionary = np.empty(n_rows * n_columns, dtype=np.uint32)
+        types = np.empty(n_columns, dtype=np.int32)
+        length, symbol_bytes = ctypes.c_int64(), ctypes.c_int32()
+        n_compositions, n_types = ctypes.c_int32(), ctypes.c_int32()
+        status = _lib.kappa_composition_cells(
+            records.ctypes.data, len(records), nbins, box_size, n_threads or 0, out.ctypes.data,
+            capacity, ctypes.byref(length), ctypes.byref(symbol_bytes), dictionary.ctypes.data,
+            dictionary.size, ctypes.byref(n_compositions), types.ctypes.data, n_columns,
+            ctypes.byref(n_types))
+        if status != 4:   # KAPPA_ERROR_BUFFER_TOO_SMALL
+            break
+        capacity, n_rows, n_columns = length.value, n_compositions.value, n_types.value
+    _check(status)
+    encoded = out[:length.value].tobytes()
+    symbols = np.frombuffer(encoded, dtype=np.uint8 if symbol_bytes.value == 1 else '>u2')
+    compositions = dictionary[:n_compositions.value * n_types.value].reshape(
+        n_compositions.value, n_types.value)
+    return encoded, symbols.astype(np.uint8 if symbol_bytes.value == 1 else np.uint16), \
+        compositions, types[:n_types.value]
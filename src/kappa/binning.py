@@ -3,11 +3,35 @@ Spatial binning of particle coordinates using Hilbert curve.
 Based on bin_finalconfig.py
 """
 
+from functools import lru_cache
+
 import numpy as np
 from hilbertcurve.hilbertcurve import HilbertCurve
 
+from . import _native
+
+
+@lru_cache(maxsize=8)
+def _hilbert_indexes(nbins):
+    """(nbins**3, 3) grid coordinates of the cells in Hilbert order."""
+    p = int(np.log2(nbins**2) / 2)
+    N = 3
+    hilbert_curve = HilbertCurve(p, N)
+
+    indexes = np.zeros((nbins**N, N), dtype=int)
+    for i in range(nbins**N):
+        indexes[i, :] = hilbert_curve.point_from_distance(i)
+    indexes.setflags(write=False)
+    return indexes
+
+
+def _encode_cells(flattened, one_symbol_per_cell):
+    if one_symbol_per_cell:
+        return ''.join([chr(ord('0') + i) for i in flattened])
+    return ''.join([str(i) for i in flattened])
 
-def bin_particles_3d(particles, nbins=32, box_size=75):
+
+def bin_particles_3d(particles, nbins=32, box_size=75, one_symbol_per_cell=False):
     """
     Bin particle coordinates into 3D grid using Hilbert curve ordering.
 
@@ -19,6 +43,10 @@ def bin_particles_3d(particles, nbins=32, box_size=75):
         Number of bins per dimension (should be power of 2)
     box_size : float
         Size of simulation box
+    one_symbol_per_cell : bool
+        If True, write each cell as the single character chr(ord('0') + count)
+        instead of the decimal count, so the string has exactly nbins**3
+        symbols (needed by the 'density' null model)
 
     Returns
     -------
@@ -36,24 +64,165 @@ def bin_particles_3d(particles, nbins=32, box_size=75):
         range=((0, box_size), (0, box_size), (0, box_size))
     )
 
-    # Set up Hilbert curve for space-filling ordering
-    p = int(np.log2(nbins**2) / 2)
-    N = 3
-    hilbert_curve = HilbertCurve(p, N)
-
-    # Get Hilbert curve indices
-    indexes = np.zeros((nbins**N, N), dtype=int)
-    for i in range(nbins**N):
-        coords = hilbert_curve.point_from_distance(i)
-        indexes[i, :] = coords
-
     # Flatten using Hilbert curve ordering
+    indexes = _hilbert_indexes(nbins)
     flattened = [int(histo[x, y, z]) for x, y, z in indexes]
-    binned = ''.join([str(i) for i in flattened])
+    binned = _encode_cells(flattened, one_symbol_per_cell)
 
     return binned
 
 
+def bin_channels_3d(particles, channels, nbins=32, box_size=75):
+    """
+    Bin several atom-type channels onto one Hilbert-ordered grid.
+
+    Every channel uses the same bin edges and cell order, so the buffers
+    line up cell by cell, as compute_mutual_information needs. Each cell is
+    one symbol chr(ord('0') + count), so all buffers have nbins**3 symbols.
+
+    Parameters
+    ----------
+    particles : np.ndarray
+        Nx4 array: [type, x, y, z]
+    channels : dict
+        {name: atom types in the channel}, e.g. {'framework': [1, 2, 3, 4, 5],
+        'guest': [10]}
+    nbins : int
+        Number of bins per dimension (should be power of 2)
+    box_size : float
+        Size of simulation box
+
+    Returns
+    -------
+    dict
+        {name: binned configuration string}
+    """
+    indexes = _hilbert_indexes(nbins)
+    cells = (indexes[:, 0], indexes[:, 1], indexes[:, 2])
+
+    if not channels:
+        return {}
+    # One histogram pass, the channel number as a fourth coordinate (a
+    # particle in several channels is counted in each)
+    members = [np.flatnonzero(np.isin(particles[:, 0], types)) for types in channels.values()]
+    rows = np.concatenate(members)
+    channel = np.repeat(np.arange(len(members)), [len(m) for m in members])
+    histo, _ = np.histogramdd(
+        np.column_stack([particles[rows, 1:4], channel]),
+        bins=(nbins, nbins, nbins, len(members)),
+        range=((0, box_size), (0, box_size), (0, box_size), (-0.5, len(members) - 0.5))
+    )
+
+    return {name: _encode_cells(histo[cells + (k,)].astype(int).tolist(), True)
+            for k, name in enumerate(channels)}
+
+
+def hilbert_sort_particles(particles, box_size=75, level=10, n_threads=None):
+    """
+    Reorder particles along the 3D Hilbert curve (needs libkappa).
+
+    Particles are keyed by their cell on a fine 2**level grid over
+    [0, box_size]^3 and radix-sorted by key in parallel, natively. Analyses
+    that walk the sorted particles touch memory in spatial order, and
+    bin_sorted_3d bins them at any coarser grid in one pass.
+
+    Parameters
+    ----------
+    particles : np.ndarray
+        Nx4 array: [type, x, y, z]
+    box_size : float
+        Size of simulation box
+    level : int
+        Key resolution, 2**level cells per dimension (at most 21)
+    n_threads : int or None
+        Sort threads (default: all cores)
+
+    Returns
+    -------
+    dict
+        {
+            'particles': Nx4 array in curve order (particles outside the
+                         box last),
+            'keys': uint64 Hilbert keys, ascending,
+            'permutation': input row of each sorted particle,
+            'inside': number of particles in the box,
+            'level': level
+        }
+    """
+    result = _native.hilbert_sort(particles, box_size, level, n_threads)
+    if result is None:
+        raise RuntimeError("hilbert_sort_particles needs libkappa (cd cpp/lz77 && make)")
+    sorted_particles, keys, permutation, inside = result
+    return {'particles': sorted_particles, 'keys': keys, 'permutation': permutation,
+            'inside': inside, 'level': level}
+
+
+def bin_sorted_3d(hilbert_sorted, nbins=32, one_symbol_per_cell=False):
+    """
+    bin_particles_3d of Hilbert-sorted particles, in one pass over their keys.
+
+    Parameters
+    ----------
+    hilbert_sorted : dict
+        Result of hilbert_sort_particles
+    nbins : int
+        Number of bins per dimension, a power of 2 up to 2**level
+    one_symbol_per_cell : bool
+        As in bin_particles_3d
+
+    Returns
+    -------
+    str
+        The string bin_particles_3d gives for the same particles and box
+    """
+    return _native.bin_sorted(hilbert_sorted['keys'], hilbert_sorted['level'], nbins,
+                              one_symbol_per_cell)
+
+
+def bin_compositions_3d(particles, nbins=32, box_size=75, n_threads=None):
+    """
+    Encode each grid cell by its composition, one symbol per cell (needs libkappa).
+
+    Instead of one grid per atom type, every cell gets the number of its
+    composition (how many particles of each type it holds, e.g. 1 Zn and
+    2 N), numbered in order of first appearance along the Hilbert curve.
+    Correlations between species sharing a cell thus show up in a single
+    CID. Built natively in one pass over the Hilbert-sorted particles.
+
+    Parameters
+    ----------
+    particles : np.ndarray
+        Nx4 array: [type, x, y, z]
+    nbins : int
+        Number of bins per dimension (power of 2)
+    box_size : float
+        Size of simulation box
+    n_threads : int or None
+        Sort threads (default: all cores)
+
+    Returns
+    -------
+    dict
+        {
+            'buffer': bytes for compute_cid and its baselines (one byte per
+                      cell, or two, high byte first, past 256 compositions),
+            'symbol_bytes': bytes per cell, 1 or 2; pass it on to
+                      compute_normalized_cid and compute_null_baselines, so
+                      that 'perm' shuffles whole cells and not their bytes,
+            'symbols': uint8 or uint16 array of the nbins**3 cell symbols,
+            'compositions': list of {type: count} per symbol,
+            'types': atom types present, ascending
+        }
+    """
+    result = _native.composition_cells(particles, nbins, box_size, n_threads)
+    if result is None:
+        raise RuntimeError("bin_compositions_3d needs libkappa (cd cpp/lz77 && make)")
+    buffer, symbols, counts, types = result
+    compositions = [{int(t): int(c) for t, c in zip(types, row) if c} for row in counts]
+    return {'buffer': buffer, 'symbol_bytes': symbols.itemsize, 'symbols': symbols,
+            'compositions': compositions, 'types': [int(t) for t in types]}
+
+
 def load_xyz_snapshot(filepath):
     """
     Load a snapshot file in xyz format.
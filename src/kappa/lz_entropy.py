@@ -9,6 +9,8 @@ import os
 from pathlib import Path
 import numpy as np
 
+from . import _native
+
 # Find the C++ executable
 _CPP_DIR = Path(__file__).parent.parent.parent / "cpp" / "lz77"
 _LZ_ENTROPY = _CPP_DIR / "lz_entropy"
@@ -20,7 +22,51 @@ if not _LZ_ENTROPY.exists():
     )
 
 
-def compute_cid(data, return_stats=False):
+def _run_lz_entropy(data, options):
+    """
+    Run the C++ tool on data (file path, str or bytes) and return its stdout.
+    """
+    tmp_path = None
+    if isinstance(data, (str, Path)) and os.path.exists(data):
+        # It's a file path
+        filepath = str(data)
+    else:
+        # It's data - write to temp file
+        with tempfile.NamedTemporaryFile(mode='wb', delete=False, suffix='.dat') as tmp:
+            if isinstance(data, str):
+                tmp.write(data.encode('utf-8'))
+            else:
+                tmp.write(data)
+            tmp_path = tmp.name
+        filepath = tmp_path
+
+    try:
+        result = subprocess.run(
+            [str(_LZ_ENTROPY)] + list(options) + [filepath],
+            capture_output=True,
+            text=True,
+            check=True
+        )
+        return result.stdout
+
+    finally:
+        # Clean up temp file
+        if tmp_path and os.path.exists(tmp_path):
+            os.unlink(tmp_path)
+
+
+def _parse_options(overlap, cost):
+    """Command line options selecting the LZ77 parse and its cost model."""
+    if cost not in ('kkp', 'gamma', 'delta', 'fixed'):
+        raise ValueError(f"Unknown cost model: {cost}")
+    options = ['--cost', cost]
+    if overlap:
+        options.append('--overlap')
+    return options
+
+
+def compute_cid(data, return_stats=False, overlap=False, cost='kkp', window=None,
+                max_chain=0, mem_budget=None):
     """
     Compute LZ77-based compression entropy (CID).
 
@@ -33,55 +79,519 @@ def compute_cid(data, return_stats=False):
         - Bytes data
     return_stats : bool
         If True, return dict with detailed stats instead of just CID
+    overlap : bool
+        If True, let a phrase copy from a source that runs into it (standard
+        LZ77); the default parse requires the source to end first
+    cost : str
+        Compressed size model: 'kkp' (estimate from the phrase count), or
+        the exact size of 'gamma', 'delta' or 'fixed' width coded phrases
+    window : int or None
+        If given, bound sources to at most `window` symbols back and phrases
+        to `window` symbols, as real compressors do; this measures local
+        repetitiveness and streams the input in O(window) memory
+    max_chain : int
+        With a window, hash-chain candidates tried per phrase (0 = all,
+        exact longest match)
+    mem_budget : int, str or None
+        Peak memory allowed for the parse, in bytes or as '512M', '4G'. The
+        exact suffix-array parse needs about 20 bytes per symbol on top of
+        the input; above the budget the largest window that fits is used
+        instead (see window)
 
     Returns
     -------
     float or dict
-        CID value (bits/char ratio, 0-1), or stats dict if return_stats=True
+        CID value (bits/char ratio, 0-1), or stats dict if return_stats=True.
+        With a mem_budget the dict also holds the plan: 'engine'
+        ('suffix_array' or 'windowed'), 'window' (0 for the suffix array),
+        'n_threads' and 'peak_bytes' (estimated)
     """
-    # Handle different input types
-    if isinstance(data, (str, Path)) and Path(data).exists():
-        # It's a file path
-        filepath = str(data)
-        with tempfile.NamedTemporaryFile(mode='w', delete=False) as tmp:
-            tmp_path = None  # Use the actual file
+    options = ['-t'] + _parse_options(overlap, cost)
+    if window:
+        options += ['--window', str(window), '--max-chain', str(max_chain)]
+    if mem_budget:
+        options += ['--mem-budget', str(mem_budget)]
+    output = _run_lz_entropy(data, options)
+
+    # Parse tab-delimited output: length\tfactors\tcid, then with a budget
+    # engine\twindow\tthreads\tpeak_bytes
+    fields = output.strip().split('\t')
+    length, factors, cid = fields[:3]
+
+    stats = {
+        'length': int(length),
+        'factors': int(factors),
+        'cid': float(cid)
+    }
+    if len(fields) > 3:
+        engine, window, n_threads, peak_bytes = fields[3:]
+        stats.update(engine=engine, window=int(window), n_threads=int(n_threads),
+                     peak_bytes=int(peak_bytes))
+
+    return stats if return_stats else stats['cid']
+
+
+def compute_cid_batch(rows, n_threads=None, overlap=False, cost='kkp', mem_budget=None):
+    """
+    Compute the CID of many symbol buffers in one native call.
+
+    All rows go to the C++ engine at once and are factorized in parallel
+    there, each worker reusing its suffix-array buffers, instead of one
+    temp file and process per buffer as with repeated compute_cid calls.
+    With libkappa built the rows are read in place, in-process; otherwise
+    they go through a temp file to the lz_entropy executable.
+
+    Parameters
+    ----------
+    rows : np.ndarray or sequence
+        (M, L) uint8 array (one buffer per row), or a sequence of M str,
+        bytes or 1D uint8 arrays of any lengths
+    n_threads : int or None
+        Worker threads (default: all cores)
+    overlap, cost
+        Parse variant and cost model, as in compute_cid
+    mem_budget : int, str or None
+        Peak memory allowed (bytes, or '512M', '4G'); fewer threads are used
+        if all of them would not fit
+
+    Returns
+    -------
+    np.ndarray
+        Structured array of M records with fields 'length', 'factors',
+        'cid' and 'seconds' (time spent on the row), in row order
+    """
+    if mem_budget is None and _native.available():
+        return _native_cid_batch(rows, n_threads, overlap, cost)
+
+    options = _parse_options(overlap, cost)
+    if n_threads:
+        options += ['-j', str(n_threads)]
+    if mem_budget:
+        options += ['--mem-budget', str(mem_budget)]
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        data_path = Path(tmp_dir) / "rows.dat"
+        if isinstance(rows, np.ndarray) and rows.ndim == 2:
+            if rows.dtype != np.uint8:
+                raise ValueError("Batch array must be uint8")
+            data_path.write_bytes(np.ascontiguousarray(rows).tobytes())
+            options += ['--rows', str(rows.shape[1])]
+        else:
+            buffers = [row.encode('utf-8') if isinstance(row, str) else
+                       np.ascontiguousarray(row, dtype=np.uint8).tobytes()
+                       if isinstance(row, np.ndarray) else bytes(row)
+                       for row in rows]
+            data_path.write_bytes(b''.join(buffers))
+            lengths_path = Path(tmp_dir) / "lengths.dat"
+            lengths_path.write_bytes(np.array([len(b) for b in buffers], dtype=np.int64).tobytes())
+            options += ['--row-lengths', str(lengths_path)]
+
+        result = subprocess.run(
+            [str(_LZ_ENTROPY)] + options + [str(data_path)],
+            capture_output=True,
+            text=True,
+            check=True
+        )
+
+    # One line per row: row\tlength\tfactors\tcid\tseconds
+    records = [tuple(line.split('\t')[1:]) for line in result.stdout.strip().splitlines()]
+    return np.array(
+        [(int(length), int(factors), float(cid), float(seconds))
+         for length, factors, cid, seconds in records],
+        dtype=[('length', np.int64), ('factors', np.int64), ('cid', np.float64),
+               ('seconds', np.float64)]
+    )
+
+
+def _native_cid_batch(rows, n_threads, overlap, cost):
+    """compute_cid_batch through libkappa, without copying 2D arrays."""
+    if isinstance(rows, np.ndarray) and rows.ndim == 2:
+        if rows.dtype != np.uint8:
+            raise ValueError("Batch array must be uint8")
+        data = np.ascontiguousarray(rows)
+        offsets = np.arange(rows.shape[0] + 1, dtype=np.int64) * rows.shape[1]
     else:
-        # It's data - write to temp file
-        with tempfile.NamedTemporaryFile(mode='wb', delete=False, suffix='.dat') as tmp:
-            if isinstance(data, str):
-                tmp.write(data.encode('utf-8'))
-            else:
-                tmp.write(data)
-            tmp_path = tmp.name
-        filepath = tmp_path
+        buffers = [row.encode('utf-8') if isinstance(row, str) else
+                   np.ascontiguousarray(row, dtype=np.uint8).tobytes()
+                   if isinstance(row, np.ndarray) else bytes(row)
+                   for row in rows]
+        data = np.frombuffer(b''.join(buffers), dtype=np.uint8)
+        offsets = np.concatenate([[0], np.cumsum([len(b) for b in buffers])]).astype(np.int64)
+    stats, seconds = _native.cid_batch(data, offsets, n_threads or 0, overlap, cost)
+    result = np.empty(len(stats), dtype=[('length', np.int64), ('factors', np.int64),
+                                         ('cid', np.float64), ('seconds', np.float64)])
+    for field in ('length', 'factors', 'cid'):
+        result[field] = stats[field]
+    result['seconds'] = seconds
+    return result
+
+
+def compute_cid_curve(data, ratio=2.0, min_prefix=16, overlap=False, cost='kkp'):
+    """
+    Compute CID as a function of prefix length in a single pass.
+
+    The LZ77 parse is left-to-right, so the phrase count of every prefix
+    is read off the parse of the whole input; no prefix is re-factorized.
+
+    Parameters
+    ----------
+    data : str, bytes, or Path
+        Input data (same forms as compute_cid)
+    ratio : float
+        Growth factor between consecutive prefix lengths (> 1)
+    min_prefix : int
+        Shortest prefix length reported
+    overlap, cost
+        Parse variant and cost model, as in compute_cid
+
+    Returns
+    -------
+    dict of np.ndarray
+        'length', 'factors' and 'cid' per prefix, in increasing length;
+        the last entry is the whole input.
+    """
+    output = _run_lz_entropy(
+        data,
+        ['--curve', '--ratio', str(ratio), '--min-prefix', str(min_prefix)]
+        + _parse_options(overlap, cost)
+    )
+    rows = [line.split('\t') for line in output.strip().splitlines()]
+
+    return {
+        'length': np.array([int(r[0]) for r in rows]),
+        'factors': np.array([int(r[1]) for r in rows]),
+        'cid': np.array([float(r[2]) for r in rows])
+    }
+
+
+def compute_online_cid(data, chunk=65536, overlap=False, cost='kkp'):
+    """
+    Compute the running CID of append-only input, chunk by chunk.
+
+    The input is parsed online with a suffix automaton, so the parse of
+    everything seen so far is available after each chunk without waiting
+    for the rest (for a live stream, pipe it into `lz_entropy --online -`).
+    Phrase counts equal those of compute_cid on every prefix.
+
+    Parameters
+    ----------
+    data : str, bytes, or Path
+        Input data (same forms as compute_cid)
+    chunk : int
+        Symbols appended between reports
+    overlap, cost
+        Parse variant and cost model, as in compute_cid
+
+    Returns
+    -------
+    dict of np.ndarray
+        'length', 'factors' and 'cid' of the input after every chunk; the
+        last entry is the whole input.
+    """
+    output = _run_lz_entropy(
+        data, ['--online', '--chunk', str(chunk)] + _parse_options(overlap, cost))
+    rows = [line.split('\t') for line in output.strip().splitlines()]
+
+    return {
+        'length': np.array([int(r[0]) for r in rows]),
+        'factors': np.array([int(r[1]) for r in rows]),
+        'cid': np.array([float(r[2]) for r in rows])
+    }
+
+
+def compute_windowed_cid(frames, window, stride=1, overlap=False, cost='kkp',
+                         n_threads=None):
+    """
+    Compute CID of sliding windows of consecutive trajectory frames.
+
+    Each window is the concatenation of `window` consecutive frames'
+    symbol buffers, so structure that persists in time compresses. Windows
+    that overlap share one suffix array instead of each being re-sorted.
+
+    Parameters
+    ----------
+    frames : sequence of str, bytes or Path
+        Symbol buffer (or file) of every frame, in time order
+    window : int
+        Frames per window
+    stride : int
+        Frames between consecutive window starts
+    overlap, cost
+        Parse variant and cost model, as in compute_cid
+    n_threads : int or None
+        Worker threads (default: all cores)
+
+    Returns
+    -------
+    dict of np.ndarray
+        'first_frame', 'length', 'factors' and 'cid' per window
+    """
+    options = ['--frames', str(window), '--stride', str(stride)]
+    options += _parse_options(overlap, cost)
+    if n_threads:
+        options += ['-j', str(n_threads)]
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        paths = []
+        for f, frame in enumerate(frames):
+            if isinstance(frame, (str, Path)) and os.path.exists(frame):
+                paths.append(str(frame))
+                continue
+            path = Path(tmp_dir) / f"frame_{f}.dat"
+            path.write_bytes(frame.encode('utf-8') if isinstance(frame, str) else bytes(frame))
+            paths.append(str(path))
 
-    try:
-        # Run C++ tool
         result = subprocess.run(
-            [str(_LZ_ENTROPY), '-t', filepath],
+            [str(_LZ_ENTROPY)] + options + paths,
             capture_output=True,
             text=True,
             check=True
         )
 
-        # Parse tab-delimited output: length\tfactors\tcid
-        length, factors, cid = result.stdout.strip().split('\t')
+    rows = [line.split('\t') for line in result.stdout.strip().splitlines()]
 
-        stats = {
-            'length': int(length),
-            'factors': int(factors),
-            'cid': float(cid)
+    return {
+        'first_frame': np.array([int(r[0]) for r in rows]),
+        'length': np.array([int(r[1]) for r in rows]),
+        'factors': np.array([int(r[2]) for r in rows]),
+        'cid': np.array([float(r[3]) for r in rows])
+    }
+
+
+def estimate_cid(data, samples=32, window=2**20, time_budget=None, seed=0,
+                 n_threads=None):
+    """
+    Estimate the CID of a very large input from randomly placed windows.
+
+    Only `samples` windows of `window` symbols are read and factorized
+    (a window reaching past the end continues from the start); the
+    convergence of the LZ77 rate inside them is extrapolated to the whole
+    input. The extrapolation assumes the input is statistically stationary
+    along the curve, so a grid whose windows miss rare structure (e.g. a
+    very sparse one) is underestimated; use compute_cid when it fits.
+
+    Parameters
+    ----------
+    data : str, bytes, np.ndarray or Path
+        Input data (same forms as compute_cid); a file is never read whole
+    samples : int
+        Windows to factorize (upper bound when time_budget is set)
+    window : int
+        Symbols per window
+    time_budget : float or None
+        Stop drawing windows after this many seconds (at least two are used)
+    seed : int
+        Seed of the window positions and of the bootstrap
+    n_threads : int or None
+        Worker threads (default: all cores)
+
+    Returns
+    -------
+    dict
+        {
+            'length': symbols in the input,
+            'factors': extrapolated phrase count,
+            'cid': estimated CID,
+            'cid_low', 'cid_high': 95% interval of the whole-input CID,
+                from the bootstrap low of 'cid' over resampled windows to
+                the bootstrap high of the input costed window by window,
+                which bounds the extrapolation error,
+            'sampling_low', 'sampling_high': 95% bootstrap interval of 'cid'
+                over resampled windows, i.e. of the choice of windows only,
+            'samples': windows actually factorized
         }
+    """
+    if isinstance(data, np.ndarray):
+        data = data.tobytes()
+
+    options = ['-t', '--sample', '--samples', str(samples),
+               '--sample-window', str(window), '--seed', str(seed)]
+    if time_budget:
+        options += ['--time-budget', str(time_budget)]
+    if n_threads:
+        options += ['-j', str(n_threads)]
+
+    # Output: length\tfactors\tcid\tlow\thigh\tsamples\tsampling_low\tsampling_high
+    length, factors, cid, low, high, count, sampling_low, sampling_high = \
+        _run_lz_entropy(data, options).strip().split('\t')
+
+    return {
+        'length': int(length),
+        'factors': float(factors),
+        'cid': float(cid),
+        'cid_low': float(low),
+        'cid_high': float(high),
+        'sampling_low': float(sampling_low),
+        'sampling_high': float(sampling_high),
+        'samples': int(count)
+    }
+
+
+def compute_mutual_information(channel_a, channel_b, overlap=False, cost='kkp'):
+    """
+    Compute compression-based mutual information between two channels.
+
+    The channels are symbol buffers of equal length over the same cells in
+    the same Hilbert order, e.g. two atom types binned by bin_channels_3d.
+    Shared structure shows up as compression gained by seeing both:
+    C(A) + C(B) - C(AB) with AB one symbol per cell for the pair (a, b)
+    (at most 256 distinct pairs), and C(B) - C(B|A) with B compressed
+    using all of A as a reference.
+
+    Parameters
+    ----------
+    channel_a, channel_b : str, bytes, np.ndarray or Path
+        Channel buffers (or files) of equal length
+    overlap, cost
+        Parse variant and cost model, as in compute_cid
+
+    Returns
+    -------
+    dict
+        'cid_a', 'cid_b', 'cid_joint' (per cell of the pair buffer),
+        'cid_b_given_a' (per symbol of B), and 'mi_joint', 'mi_conditional'
+        in CID units (bits per cell / 8). Both are near 0 (slightly
+        positive) for independent channels and near cid_a for identical
+        ones; mi_joint is then exactly cid_a, mi_conditional falls short of
+        it by about 2 bits per LZ77 phrase of A under the kkp cost.
+    """
+    options = ['--mi'] + _parse_options(overlap, cost)
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        paths = []
+        for name, channel in (('a', channel_a), ('b', channel_b)):
+            if isinstance(channel, (str, Path)) and os.path.exists(channel):
+                paths.append(str(channel))
+                continue
+            if isinstance(channel, np.ndarray):
+                channel = channel.tobytes()
+            path = Path(tmp_dir) / f"channel_{name}.dat"
+            path.write_bytes(channel.encode('utf-8') if isinstance(channel, str) else channel)
+            paths.append(str(path))
+
+        result = subprocess.run(
+            [str(_LZ_ENTROPY)] + options + paths,
+            capture_output=True,
+            text=True,
+            check=True
+        )
 
-        return stats if return_stats else stats['cid']
+    keys = ('cid_a', 'cid_b', 'cid_joint', 'cid_b_given_a', 'mi_joint', 'mi_conditional')
+    return dict(zip(keys, (float(v) for v in result.stdout.strip().split('\t'))))
 
+
+def compute_lpf(data):
+    """
+    Compute the longest-previous-factor (LPF) array in linear time.
+
+    Parameters
+    ----------
+    data : str, bytes, or Path
+        Input data (same forms as compute_cid)
+
+    Returns
+    -------
+    lpf : np.ndarray of int32
+        lpf[i] is the length of the longest prefix of data[i:] that also
+        starts at some earlier position (the occurrence may overlap i)
+    prev_occ : np.ndarray of int32
+        Start of such an earlier occurrence, -1 where lpf[i] == 0
+    """
+    with tempfile.NamedTemporaryFile(delete=False, suffix='.lpf') as tmp:
+        out_path = tmp.name
+
+    try:
+        _run_lz_entropy(data, ['--lpf', out_path])
+        arrays = np.fromfile(out_path, dtype=np.int32)
     finally:
-        # Clean up temp file
-        if tmp_path and os.path.exists(tmp_path):
-            os.unlink(tmp_path)
+        os.unlink(out_path)
+
+    n = len(arrays) // 2
+    return arrays[:n], arrays[n:]
+
+
+def _byte_null_model(null_model, symbol_bytes):
+    """The null model on bytes that shuffles symbols of symbol_bytes bytes as units."""
+    if symbol_bytes == 1:
+        return null_model
+    if symbol_bytes != 2:
+        raise ValueError(f"symbol_bytes must be 1 or 2, got {symbol_bytes}")
+    if null_model == 'perm':
+        return 'block:1'
+    if null_model.startswith('block:'):
+        return f"block:{int(null_model[len('block:'):]) + 1}"
+    raise ValueError(f"Null model {null_model!r} needs one byte per symbol")
+
+
+def compute_null_baselines(data, null_models=('perm',), n_shuffles=1, seed=None,
+                           n_threads=None, symbol_bytes=1):
+    """
+    Compute CID together with shuffled baselines from several null models.
+
+    All baselines run natively in one process, in parallel, each replicate
+    seeded from (seed, null model, replicate) so results do not depend on
+    the thread count.
+
+    Parameters
+    ----------
+    data : str, bytes, np.ndarray or Path
+        Symbol buffer in Hilbert order
+    null_models : sequence of str
+        'perm' (full permutation), 'block:K' (permute Hilbert-contiguous
+        blocks of 2**K symbols, keeping structure below that scale) or
+        'density:K' (move particles among the cells of each super-cell of
+        8**K cells, keeping the coarse density; needs one symbol per cell,
+        see bin_particles_3d(one_symbol_per_cell=True))
+    n_shuffles : int
+        Replicates per null model
+    seed : int or None
+        Base seed; drawn from np.random if None
+    n_threads : int or None
+        Worker threads (default: all cores)
+    symbol_bytes : int
+        Bytes per symbol (2 for the 'buffer' of bin_compositions_3d past
+        256 compositions); 'perm' and 'block:K' then move whole symbols,
+        as 'block:1' and 'block:K+1' on the bytes, and 'density:K' is
+        rejected. Shuffling the bytes of two-byte symbols apart would mint
+        symbols the input never had and inflate the baseline.
+
+    Returns
+    -------
+    dict
+        {
+            'cid': original CID,
+            'baselines': {null_model: np.ndarray of n_shuffles CIDs}
+        }
+    """
+    if isinstance(data, np.ndarray):
+        data = data.tobytes()
+    if seed is None:
+        seed = int(np.random.randint(0, 2**31))
+
+    byte_models = {_byte_null_model(model, symbol_bytes): model for model in null_models}
+    options = ['-t', '--shuffles', str(n_shuffles), '--seed', str(seed)]
+    for model in byte_models:
+        options += ['--null', model]
+    if n_threads:
+        options += ['-j', str(n_threads)]
+
+    lines = _run_lz_entropy(data, options).strip().splitlines()
+
+    # First line: length\tfactors\tcid, then model\treplicate\tlength\tfactors\tcid
+    cid_orig = float(lines[0].split('\t')[2])
+    baselines = {}
+    for line in lines[1:]:
+        model, _, _, _, cid = line.split('\t')
+        baselines.setdefault(byte_models[model], []).append(float(cid))
+
+    return {
+        'cid': cid_orig,
+        'baselines': {model: np.array(cids) for model, cids in baselines.items()}
+    }
 
 
-def compute_normalized_cid(data, n_shuffles=1):
+def compute_normalized_cid(data, n_shuffles=1, null_model='perm', seed=None,
+                           n_threads=None, symbol_bytes=1):
     """
     Compute CID normalized by shuffled baseline.
 
@@ -95,6 +605,16 @@ def compute_normalized_cid(data, n_shuffles=1):
         Input data (must be bytes or binary array)
     n_shuffles : int
         Number of shuffles to average over (default: 1)
+    null_model : str
+        Baseline to normalize by (see compute_null_baselines); the default
+        'perm' shuffles all symbols
+    seed : int or None
+        Base seed of the shuffles; drawn from np.random if None
+    n_threads : int or None
+        Threads for the shuffles (default: all cores)
+    symbol_bytes : int
+        Bytes per symbol, as in compute_null_baselines; pass the
+        'symbol_bytes' of bin_compositions_3d with its 'buffer'
 
     Returns
     -------
@@ -120,17 +640,13 @@ def compute_normalized_cid(data, n_shuffles=1):
     else:
         data_bytes = data
 
-    # Compute CID of original
-    cid_orig = compute_cid(data_bytes)
-
-    # Compute CID of shuffled versions
-    cid_shuffled_list = []
-    data_array = np.frombuffer(data_bytes, dtype=np.uint8)
-
-    for _ in range(n_shuffles):
-        shuffled = np.random.permutation(data_array)
-        cid_shuf = compute_cid(shuffled.tobytes())
-        cid_shuffled_list.append(cid_shuf)
+    # Original and shuffled CIDs in one native call
+    result = compute_null_baselines(
+        data_bytes, [null_model], n_shuffles, seed=seed, n_threads=n_threads,
+        symbol_bytes=symbol_bytes
+    )
+    cid_orig = result['cid']
+    cid_shuffled_list = result['baselines'][null_model]
 
     cid_shuffled_mean = np.mean(cid_shuffled_list)
 
@@ -151,10 +667,92 @@ def compute_normalized_cid(data, n_shuffles=1):
     }
 
 
+def compute_type_sequence_cid(particles, box_size=75, n_shuffles=1, null_model='perm',
+                              seed=None, n_threads=None, level=21):
+    """
+    Normalized CID of the particle types read along the 3D Hilbert curve.
+
+    The particles are sorted along the curve (at a fine key resolution,
+    natively) and their type labels form a string of one symbol per
+    particle, so compositional order (demixing, ordered alloys, guests
+    sitting next to particular framework atoms) is measured without a
+    grid. Time and memory grow with the number of particles, not with a
+    grid's nbins**3 cells.
+
+    Parameters
+    ----------
+    particles : np.ndarray
+        Nx4 array: [type, x, y, z] (see read_lammps_data)
+    box_size : float
+        Size of simulation box; particles outside are left out
+    n_shuffles, null_model, seed, n_threads
+        Baselines, as in compute_normalized_cid; 'perm' mixes the types
+        at random, keeping the composition
+    level : int
+        Key resolution, 2**level cells per dimension (at most 21)
+
+    Returns
+    -------
+    dict
+        compute_normalized_cid of the type string, plus 'length' (particles
+        in the box) and 'n_types'
+    """
+    sequence = _native.type_sequence(particles, box_size, level, n_threads)
+    if sequence is None:
+        raise RuntimeError("compute_type_sequence_cid needs libkappa (cd cpp/lz77 && make)")
+    result = compute_normalized_cid(sequence.encode('ascii'), n_shuffles, null_model, seed,
+                                    n_threads)
+    result['length'] = len(sequence)
+    result['n_types'] = len(set(sequence))
+    return result
+
+
+def compute_key_gap_cid(particles, box_size=75, level=10, quantize_bits=0, n_shuffles=1,
+                        null_model='perm', seed=None, n_threads=None):
+    """
+    Normalized CID of particle positions as gaps between Hilbert keys.
+
+    Instead of histogramming, the particles are sorted by their Hilbert
+    key on a 2**level grid and the gaps between consecutive keys are
+    written as variable-length bytes (LEB128), then parsed as usual.
+    Sub-cell placement is kept down to the key resolution, and time and
+    memory grow with the number of particles rather than with nbins**3.
+
+    Parameters
+    ----------
+    particles : np.ndarray
+        Nx4 array: [type, x, y, z]
+    box_size : float
+        Size of simulation box; particles outside are left out
+    level : int
+        Key resolution, 2**level cells per dimension (at most 21)
+    quantize_bits : int
+        Low bits dropped from every gap; coarser gaps repeat more often
+    n_shuffles, null_model, seed, n_threads
+        Baselines of the byte stream, as in compute_normalized_cid
+
+    Returns
+    -------
+    dict
+        compute_normalized_cid of the gap stream, plus 'length' (bytes)
+        and 'particles' (particles in the box)
+    """
+    stream = _native.key_gaps(particles, box_size, level, quantize_bits, n_threads)
+    if stream is None:
+        raise RuntimeError("compute_key_gap_cid needs libkappa (cd cpp/lz77 && make)")
+    result = compute_normalized_cid(stream, n_shuffles, null_model, seed, n_threads)
+    result['length'] = len(stream)
+    result['particles'] = sum(1 for byte in stream if byte < 0x80)
+    return result
+
+
 def batch_process(filepaths, normalized=True, n_shuffles=1, verbose=False):
     """
     Process multiple files in batch.
 
+    Returns once every file is done; kappa.imap streams the results of
+    many files as they complete, on the native worker pool.
+
     Parameters
     ----------
     filepaths : list of Path or str
@@ -0,0 +1,233 @@
+"""
+Asynchronous and streaming CID of many inputs on libkappa's worker pool.
+
+Files (symbol strings, xyz snapshots, LAMMPS data files) or buffers are
+read, binned, parsed and shuffled on native threads that never hold the
+GIL, while Python goes on submitting or consuming results. At most
+max_in_flight jobs are outstanding at a time, so memory stays bounded
+however many inputs are streamed through.
+
+    future = kappa.submit('frame_001.xyz', nbins=32)       # concurrent.futures
+    result = await kappa.submit_async('frame_002.xyz')      # asyncio
+    for result in kappa.imap(paths, n_shuffles=3):          # completion order
+        print(result['source'], result['cid_normalized'])
+"""
+
+import asyncio
+import atexit
+import ctypes
+import functools
+import os
+import threading
+from concurrent.futures import FIRST_COMPLETED, Future, wait
+from pathlib import Path
+
+import numpy as np
+
+from . import _native
+
+_PARTICLE_INPUTS = {'.xyz': _native.INPUT_XYZ, '.data': _native.INPUT_LAMMPS,
+                    '.lmp': _native.INPUT_LAMMPS, '.lammps': _native.INPUT_LAMMPS}
+
+
+class Pool:
+    """
+    Native worker pool with a bounded in-flight window.
+
+    Parameters
+    ----------
+    n_threads : int or None
+        Worker threads (default: all cores)
+    max_in_flight : int or None
+        Jobs submitted and not yet finished before submit blocks (default:
+        two per worker)
+    trace : str, Path or None
+        Chrome trace JSON file (open in Perfetto) of the read, bin, cid and
+        shuffle tasks of every worker, written when the pool is closed.
+        Recording is process-wide: it stays on afterwards, and the file
+        also gets the tasks of other native calls.
+    """
+
+    def __init__(self, n_threads=None, max_in_flight=None, trace=None):
+        lib = _native._load()
+        if lib is None:
+            raise RuntimeError("libkappa is not built (cd cpp/lz77 && make)")
+        self._lib = lib
+        self.trace = trace
+        if trace is not None:
+            _native.trace_start(trace)
+        self.n_threads = n_threads or os.cpu_count() or 1
+        self.max_in_flight = max_in_flight or 2 * self.n_threads
+        self._handle = lib.kappa_pool_create(self.n_threads, self.max_in_flight)
+        if not self._handle:
+            raise RuntimeError(lib.kappa_last_error().decode())
+        self._lock = threading.Lock()
+        self._pending = {}    # job id -> (future, source, buffer kept alive)
+        self._early = {}      # results that arrived before submit registered them
+        self._collector = threading.Thread(target=self._collect, daemon=True)
+        self._collector.start()
+
+    def submit(self, source, nbins=32, box_size=None, one_symbol_per_cell=False,
+               n_shuffles=1, seed=None, overlap=False, cost='kkp'):
+        """
+        Queue one input and return a concurrent.futures.Future of its result.
+
+        Parameters
+        ----------
+        source : str, Path, bytes or np.ndarray
+            A file (.xyz and LAMMPS .data/.lmp files are binned, anything
+            else is read as the symbol string) or the symbols themselves
+        nbins, box_size, one_symbol_per_cell
+            Grid of particle inputs, as in bin_particles_3d; box_size
+            defaults to the box of a LAMMPS file and to 75 for xyz files
+        n_shuffles : int
+            Permutation baselines to normalize by (0: CID only)
+        seed : int or None
+            Seed of the shuffles; drawn from np.random if None
+        overlap, cost
+            Parse variant and cost model, as in compute_cid
+
+        Blocks while max_in_flight jobs are outstanding. The result is a
+        dict with 'source', 'length', 'factors', 'cid' and 'seconds', plus
+        'cid_shuffled', 'cid_shuffled_std', 'cid_normalized' and
+        'compression_gain' when n_shuffles > 0; a failed job raises
+        _native.KappaError from Future.result().
+        """
+        job = _native._Job()
+        job.nbins = nbins
+        job.one_symbol_per_cell = 1 if one_symbol_per_cell else 0
+        job.n_shuffles = n_shuffles
+        job.seed = int(np.random.randint(0, 2**31)) if seed is None else seed
+        job.options = _native._options(overlap, cost)
+        job_id = ctypes.c_int64()
+        buffer = None
+
+        if isinstance(source, Path) or (isinstance(source, str) and os.path.exists(source)):
+            path = Path(source)
+            job.input = _PARTICLE_INPUTS.get(path.suffix.lower(), _native.INPUT_SYMBOLS)
+            if box_size is not None:
+                job.box_size = box_size
+            elif job.input == _native.INPUT_XYZ:
+                job.box_size = 75
+            status = self._lib.kappa_pool_submit(self._handle, str(path).encode(),
+                                                 ctypes.byref(job), ctypes.byref(job_id))
+        else:
+            buffer = _native._as_bytes(source)
+            job.input = _native.INPUT_SYMBOLS
+            status = self._lib.kappa_pool_submit_data(self._handle, buffer.ctypes.data,
+                                                      buffer.size, ctypes.byref(job),
+                                                      ctypes.byref(job_id))
+        if status != 0:
+            raise _native.KappaError(status, self._lib.kappa_last_error().decode())
+
+        future = Future()
+        future.set_running_or_notify_cancel()
+        with self._lock:
+            result = self._early.pop(job_id.value, None)
+            if result is None:
+                self._pending[job_id.value] = (future, str(source)
+                                               if buffer is None else None, buffer)
+        if result is not None:
+            self._resolve(future, str(source) if buffer is None else None, result)
+        return future
+
+    async def submit_async(self, source, **job):
+        """Coroutine form of submit, waiting for a free slot off the event loop."""
+        loop = asyncio.get_running_loop()
+        future = await loop.run_in_executor(None, functools.partial(self.submit, source, **job))
+        return await asyncio.wrap_future(future)
+
+    def imap(self, sources, **job):
+        """
+        Yield the results of all sources (see submit) as they complete.
+
+        Sources are consumed lazily, keeping at most max_in_flight of them
+        outstanding, so a long stream of frames runs in bounded memory.
+        """
+        pending = set()
+        for source in sources:
+            pending.add(self.submit(source, **job))
+            if len(pending) >= self.max_in_flight:
+                done, pending = wait(pending, return_when=FIRST_COMPLETED)
+                for future in done:
+                    yield future.result()
+        while pending:
+            done, pending = wait(pending, return_when=FIRST_COMPLETED)
+            for future in done:
+                yield future.result()
+
+    def close(self):
+        """Wait for the outstanding jobs and stop the workers."""
+        if not self._handle:
+            return
+        with self._lock:
+            futures = [entry[0] for entry in self._pending.values()]
+        wait(futures)
+        self._lib.kappa_pool_close(self._handle)
+        self._collector.join()
+        self._lib.kappa_pool_destroy(self._handle)
+        self._handle = None
+        if self.trace is not None:
+            _native.trace_write(self.trace)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _collect(self):
+        # Blocks in native code (GIL released) until a job finishes
+        result = _native._Result()
+        while self._lib.kappa_pool_wait(self._handle, -1.0, ctypes.byref(result)):
+            copy = _native._Result.from_buffer_copy(result)
+            with self._lock:
+                entry = self._pending.pop(result.id, None)
+                if entry is None:
+                    self._early[result.id] = copy
+            if entry is not None:
+                self._resolve(entry[0], entry[1], copy)
+
+    @staticmethod
+    def _resolve(future, source, result):
+        if result.status != 0:
+            future.set_exception(_native.KappaError(result.status, result.error.decode()))
+            return
+        record = {'source': source, 'length': result.stats.length,
+                  'factors': result.stats.factors, 'cid': result.stats.cid,
+                  'seconds': result.seconds}
+        if result.cid_shuffled > 0:
+            record['cid_shuffled'] = result.cid_shuffled
+            record['cid_shuffled_std'] = result.cid_shuffled_std
+            record['cid_normalized'] = result.stats.cid / result.cid_shuffled
+            record['compression_gain'] = 1.0 - record['cid_normalized']
+        future.set_result(record)
+
+
+_default_pool = None
+_default_lock = threading.Lock()
+
+
+def default_pool():
+    """Pool on all cores shared by submit, submit_async and imap."""
+    global _default_pool
+    with _default_lock:
+        if _default_pool is None:
+            _default_pool = Pool()
+            atexit.register(_default_pool.close)
+        return _default_pool
+
+
+def submit(source, **job):
+    """Pool.submit on the default pool."""
+    return default_pool().submit(source, **job)
+
+
+async def submit_async(source, **job):
+    """Pool.submit_async on the default pool."""
+    return await default_pool().submit_async(source, **job)
+
+
+def imap(sources, **job):
+    """Pool.imap on the default pool."""
+    return default_pool().imap(sources, **job)
@@ -6,8 +6,20 @@ Test the LZ entropy calculator with different patterns.
 import sys
 sys.path.insert(0, 'src')
 
-from kappa import compute_cid, compute_normalized_cid
+from kappa import (bin_channels_3d, bin_particles_3d, compute_cid, compute_cid_batch,
+                   compute_cid_curve,
+                   compute_lpf, compute_mutual_information, compute_normalized_cid,
+                   compute_null_baselines, compute_online_cid, compute_windowed_cid,
+                   estimate_cid, load_xyz_snapshot)
+from kappa import _native
+import asyncio
+import ctypes
+import glob
+import json
 import os
+import tempfile
+from pathlib import Path
+import numpy as np
 
 def test_pattern(name, data, n_shuffles=5):
     """Test a specific data pattern."""
@@ -29,6 +41,454 @@ def test_pattern(name, data, n_shuffles=5):
 
     return result
 
+def test_curve(name, data):
+    """Test the prefix-CID convergence curve."""
+    print(f"\n{'='*60}")
+    print(f"Testing prefix curve: {name}")
+    print(f"{'='*60}")
+
+    curve = compute_cid_curve(data, ratio=2.0, min_prefix=16)
+    for length, factors, cid in zip(curve['length'], curve['factors'], curve['cid']):
+        print(f"  {length:8d} {factors:8d} {cid:.4f}")
+
+    # The last point is the whole input, each point a truncated prefix
+    assert curve['length'][-1] == len(data)
+    assert abs(curve['cid'][-1] - compute_cid(data)) < 1e-6
+    mid = len(curve['length']) // 2
+    prefix = compute_cid(data[:curve['length'][mid]], return_stats=True)
+    assert curve['factors'][mid] == prefix['factors']
+
+    # Fixed-width fields are sized to each prefix, not to the whole input
+    fixed = compute_cid_curve(data, ratio=2.0, min_prefix=16, cost='fixed')
+    for length, cid in zip(fixed['length'], fixed['cid']):
+        assert abs(cid - compute_cid(data[:length], cost='fixed')) < 1e-5
+
+    return curve
+
+def test_lpf(name, data):
+    """Test the longest-previous-factor array against its definition."""
+    print(f"\n{'='*60}")
+    print(f"Testing LPF: {name}")
+    print(f"{'='*60}")
+
+    lpf, prev_occ = compute_lpf(data)
+    print(f"LPF: {lpf.tolist()}")
+
+    for i in range(len(data)):
+        j = prev_occ[i]
+        if lpf[i] == 0:
+            assert j == -1
+            assert data[i] not in data[:i]
+        else:
+            assert 0 <= j < i
+            assert data[j:j + lpf[i]] == data[i:i + lpf[i]]
+            # No earlier occurrence of the one-longer prefix
+            if i + lpf[i] < len(data):
+                longer = data[i:i + lpf[i] + 1]
+                assert all(data[k:k + len(longer)] != longer for k in range(i))
+
+    return lpf
+
+def test_variants(name, data):
+    """Compare the non-overlapping and overlapping parses and cost models."""
+    print(f"\n{'='*60}")
+    print(f"Testing parse variants: {name}")
+    print(f"{'='*60}")
+
+    for overlap in (False, True):
+        for cost in ('kkp', 'gamma', 'delta', 'fixed'):
+            stats = compute_cid(data, return_stats=True, overlap=overlap, cost=cost)
+            print(f"  overlap={overlap!s:5} {cost:5}: factors {stats['factors']:4d}  CID {stats['cid']:.4f}")
+
+    # A period-3 string: one literal per symbol, then a single self-overlapping copy
+    overlapping = compute_cid(data, return_stats=True, overlap=True)
+    plain = compute_cid(data, return_stats=True)
+    assert overlapping['factors'] == 4
+    assert plain['factors'] > overlapping['factors']
+
+def test_null_models(name, data):
+    """Test the native null models and their determinism."""
+    print(f"\n{'='*60}")
+    print(f"Testing null models: {name}")
+    print(f"{'='*60}")
+
+    models = ['perm', 'block:2', 'block:5', 'density:1']
+    result = compute_null_baselines(data, models, n_shuffles=3, seed=42)
+    print(f"CID (original):  {result['cid']:.4f}")
+    for model in models:
+        cids = result['baselines'][model]
+        print(f"  {model:10s} {cids.mean():.4f} ± {cids.std():.4f}")
+
+    # Same seed, different thread count: identical baselines
+    again = compute_null_baselines(data, models, n_shuffles=3, seed=42, n_threads=1)
+    for model in models:
+        assert np.array_equal(result['baselines'][model], again['baselines'][model])
+
+    return result
+
+def test_windows(name, frames, window, stride):
+    """Test windowed CID over concatenated frames against direct CIDs."""
+    print(f"\n{'='*60}")
+    print(f"Testing windowed CID: {name} (window {window}, stride {stride})")
+    print(f"{'='*60}")
+
+    result = compute_windowed_cid(frames, window, stride=stride)
+    for first, cid in zip(result['first_frame'], result['cid']):
+        direct = compute_cid(b''.join(frames[first:first + window]))
+        print(f"  frames {first}-{first + window - 1}: CID {cid:.4f} (direct {direct:.4f})")
+        assert abs(cid - direct) < 1e-6
+
+    return result
+
+def test_sampled(name, data, window):
+    """Test the sampled CID estimate against the exact CID."""
+    print(f"\n{'='*60}")
+    print(f"Testing sampled estimate: {name} (window {window})")
+    print(f"{'='*60}")
+
+    exact = compute_cid(data)
+    estimate = estimate_cid(data, samples=16, window=window, seed=1)
+    print(f"CID (exact):     {exact:.4f}")
+    print(f"CID (estimate):  {estimate['cid']:.4f} "
+          f"[{estimate['cid_low']:.4f}, {estimate['cid_high']:.4f}] "
+          f"(windows [{estimate['sampling_low']:.4f}, {estimate['sampling_high']:.4f}])")
+    assert estimate['samples'] == 16
+    assert estimate['sampling_low'] <= estimate['cid'] <= estimate['sampling_high']
+    assert estimate['cid_low'] <= estimate['sampling_low']
+    assert estimate['sampling_high'] <= estimate['cid_high']
+    assert estimate['cid_low'] <= exact <= estimate['cid_high']
+    assert abs(estimate['cid'] - exact) < 0.1 * exact
+
+    # The interval is the spread over the choice of windows only: windows
+    # that all look alike give no spread, however far the extrapolation is
+    # from the exact CID
+    uniform = estimate_cid(b'0' * len(data), samples=16, window=window, seed=1)
+    assert uniform['sampling_low'] == uniform['cid'] == uniform['sampling_high']
+
+    return estimate
+
+def test_sampled_coverage(name, particles, grids):
+    """Test that the sampled interval covers the exact CID of a real snapshot."""
+    print(f"\n{'='*60}")
+    print(f"Testing sampled interval coverage: {name}")
+    print(f"{'='*60}")
+
+    for nbins, window in grids:
+        data = bin_particles_3d(particles, nbins=nbins, box_size=75, one_symbol_per_cell=True)
+        exact = compute_cid(data)
+        estimate = estimate_cid(data, samples=32, window=window, seed=1)
+        print(f"  {nbins}^3, window {window:5d}: exact {exact:.4f}, estimate "
+              f"{estimate['cid']:.4f} [{estimate['cid_low']:.4f}, {estimate['cid_high']:.4f}]")
+        assert estimate['cid_low'] <= exact <= estimate['cid_high']
+
+def test_bounded_window(name, data):
+    """Test the window-bounded streaming parse."""
+    print(f"\n{'='*60}")
+    print(f"Testing bounded window: {name}")
+    print(f"{'='*60}")
+
+    unbounded = compute_cid(data, return_stats=True)
+    for window in (16, 256, len(data)):
+        stats = compute_cid(data, return_stats=True, window=window)
+        print(f"  window {window:6d}: {stats['factors']} factors, CID {stats['cid']:.4f}")
+        assert stats['factors'] >= unbounded['factors']
+
+    # A window covering the input finds the same greedy parse
+    assert compute_cid(data, return_stats=True, window=len(data))['factors'] == \
+        unbounded['factors']
+
+def test_online(name, data, chunk):
+    """Test the online parse against compute_cid of every reported prefix."""
+    print(f"\n{'='*60}")
+    print(f"Testing online parse: {name} (chunk {chunk})")
+    print(f"{'='*60}")
+
+    for overlap in (False, True):
+        running = compute_online_cid(data, chunk=chunk, overlap=overlap)
+        for length, factors in zip(running['length'], running['factors']):
+            prefix = compute_cid(data[:length], return_stats=True, overlap=overlap)
+            assert factors == prefix['factors']
+        print(f"  overlap={overlap}: {len(running['length'])} reports, "
+              f"final CID {running['cid'][-1]:.4f}")
+    assert running['length'][-1] == len(data)
+
+def test_mutual_information(name, particles, channels, nbins, box_size):
+    """Test channel binning and compression-based mutual information."""
+    print(f"\n{'='*60}")
+    print(f"Testing mutual information: {name}")
+    print(f"{'='*60}")
+
+    binned = bin_channels_3d(particles, channels, nbins=nbins, box_size=box_size)
+    for channel, types in channels.items():
+        subset = particles[np.isin(particles[:, 0], types)]
+        assert binned[channel] == bin_particles_3d(subset, nbins=nbins, box_size=box_size,
+                                                   one_symbol_per_cell=True)
+
+    a, b = binned.values()
+    result = compute_mutual_information(a, b)
+    for key, value in result.items():
+        print(f"  {key:15s} {value:.4f}")
+    assert abs(result['cid_a'] - compute_cid(a)) < 1e-9
+
+    # A channel shares all its information with itself: the pair buffer
+    # is A relabeled, and B given A costs little beyond addressing A.B
+    same = compute_mutual_information(a, a)
+    assert abs(same['mi_joint'] - same['cid_a']) < 1e-5
+    assert same['cid_b_given_a'] < 0.15 * same['cid_b']
+    assert same['mi_conditional'] > result['mi_conditional']
+
+    # Independent channels share close to nothing
+    coin = np.random.default_rng(11)
+    x, y = ((coin.random((2, 32**3)) < 0.3) + ord('0')).astype(np.uint8)
+    independent = compute_mutual_information(x, y)
+    for key in ('mi_joint', 'mi_conditional'):
+        assert abs(independent[key]) < 0.1 * independent['cid_a']
+    print(f"  independent: mi_joint {independent['mi_joint']:.4f}, "
+          f"mi_conditional {independent['mi_conditional']:.4f}")
+
+    return result
+
+def test_batch(name, rows):
+    """Test the batch API against one compute_cid call per row."""
+    print(f"\n{'='*60}")
+    print(f"Testing batch: {name}")
+    print(f"{'='*60}")
+
+    result = compute_cid_batch(rows, n_threads=2)
+    for row, record in zip(rows, result):
+        data = row.tobytes() if isinstance(row, np.ndarray) else row
+        assert record['length'] == len(data)
+        # compute_cid reads the executable's output, 6 significant digits
+        assert abs(record['cid'] - compute_cid(data)) < 1e-5
+    print(f"  {len(result)} rows, CID {result['cid'].min():.4f} - {result['cid'].max():.4f}, "
+          f"{result['seconds'].sum() * 1e3:.2f} ms")
+
+    return result
+
+def test_mem_budget(name, data):
+    """Test that a tight memory budget falls back to a bounded window."""
+    print(f"\n{'='*60}")
+    print(f"Testing memory budget: {name}")
+    print(f"{'='*60}")
+
+    exact = compute_cid(data, return_stats=True)
+    roomy = compute_cid(data, return_stats=True, mem_budget='64M')
+    assert {key: roomy[key] for key in exact} == exact
+    assert roomy['engine'] == 'suffix_array' and roomy['window'] == 0
+    assert roomy['peak_bytes'] <= 64 * 2**20
+    tight = compute_cid(data, return_stats=True, mem_budget=2 * 2**20)
+    assert tight['length'] == exact['length']
+    assert tight['factors'] >= exact['factors']
+    assert tight['engine'] == 'windowed' and 16 <= tight['window'] < len(data)
+    assert tight['peak_bytes'] <= 2 * 2**20
+    print(f"  exact {exact['factors']} factors, within 2 MB {tight['factors']} factors "
+          f"(window {tight['window']})")
+
+    return tight
+
+def test_native(name, particles, nbins, box_size):
+    """Test the in-process library against the executable and Python binning."""
+    print(f"\n{'='*60}")
+    print(f"Testing libkappa: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    binned = _native.bin_particles(particles, nbins=nbins, box_size=box_size)
+    assert binned == bin_particles_3d(particles, nbins=nbins, box_size=box_size)
+    stats = _native.Workspace().cid(binned)
+    assert abs(stats['cid'] - compute_cid(binned)) < 1e-5
+    try:
+        _native.Workspace().cid(b"")
+        assert False, "empty input accepted"
+    except _native.KappaError as e:
+        assert e.status == 1
+    print(f"  {len(binned)} symbols, CID {stats['cid']:.4f}")
+
+    return stats
+
+def test_pool(name, paths):
+    """Test submit, submit_async and imap against the synchronous API."""
+    print(f"\n{'='*60}")
+    print(f"Testing worker pool: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    from kappa import Pool
+    with Pool(n_threads=2, max_in_flight=2) as pool:
+        results = list(pool.imap(paths, nbins=16, n_shuffles=2, seed=3))
+        assert sorted(r['source'] for r in results) == sorted(map(str, paths))
+        for result in results:
+            binned = bin_particles_3d(load_xyz_snapshot(result['source']), nbins=16, box_size=75)
+            assert abs(result['cid'] - compute_cid(binned)) < 1e-5
+            assert result['cid_normalized'] < 1
+        same = pool.submit(paths[0], nbins=16, n_shuffles=2, seed=3).result()
+        assert same['cid_shuffled'] == next(r for r in results
+                                            if r['source'] == str(paths[0]))['cid_shuffled']
+        data = b"ABC" * 100
+        result = asyncio.run(pool.submit_async(data, n_shuffles=0))
+        assert abs(result['cid'] - compute_cid(data)) < 1e-5
+        try:
+            pool.submit(Path(paths[0]).with_suffix('.missing.xyz')).result()
+            assert False, "missing file accepted"
+        except _native.KappaError as e:
+            assert e.status == 2
+
+    # Tasks of the pool's workers are traced through libkappa alone
+    trace = Path(tempfile.mkdtemp()) / 'pool_trace.json'
+    with Pool(n_threads=2, trace=trace) as pool:
+        list(pool.imap(paths[:2], nbins=16, n_shuffles=1, seed=3))
+    events = json.loads(trace.read_text())['traceEvents']
+    stages = {e['name'] for e in events if e['ph'] == 'X'}
+    assert {'read', 'bin', 'cid', 'shuffle'} <= stages, stages
+    try:
+        _native.trace_write(trace.parent / 'missing' / 'trace.json')
+        assert False, "unwritable trace accepted"
+    except _native.KappaError as e:
+        assert e.status == 2
+
+    # Closing and destroying a pool whose job is still running must let the
+    # job store its result first. Jobs are taken in submission order, so once
+    # the small job's result is in, the large one is known to be running.
+    lib = _native.library()
+    handle = lib.kappa_pool_create(2, 2)
+    small = np.frombuffer(data, dtype=np.uint8)
+    large = np.random.default_rng(0).integers(0, 4, 1 << 20, dtype=np.uint8)
+    job = _native._Job()
+    job.input = _native.INPUT_SYMBOLS
+    job.n_shuffles = 2
+    ids = []
+    for buffer in (large, small):
+        job_id = ctypes.c_int64()
+        assert lib.kappa_pool_submit_data(handle, buffer.ctypes.data, buffer.size,
+                                          ctypes.byref(job), ctypes.byref(job_id)) == 0
+        ids.append(job_id.value)
+    first = _native._Result()
+    assert lib.kappa_pool_wait(handle, -1, ctypes.byref(first)) == 1
+    assert first.id == ids[1] and first.status == 0
+    lib.kappa_pool_close(handle)
+    assert lib.kappa_pool_wait(handle, -1, ctypes.byref(_native._Result())) == 0
+    lib.kappa_pool_destroy(handle)
+    print(f"  {len(results)} snapshots, CID {min(r['cid'] for r in results):.4f} - "
+          f"{max(r['cid'] for r in results):.4f}")
+
+    return results
+
+def test_hilbert_sort(name, particles, box_size, level):
+    """Test that binning sorted particles matches binning them in file order."""
+    print(f"\n{'='*60}")
+    print(f"Testing Hilbert sort: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    from kappa import bin_sorted_3d, hilbert_sort_particles
+    result = hilbert_sort_particles(particles, box_size=box_size, level=level)
+    assert np.array_equal(result['particles'], particles[result['permutation']])
+    assert np.all(np.diff(result['keys'].astype(np.int64)) >= 0)
+    for nbins in (2, 8, 2**level):
+        assert bin_sorted_3d(result, nbins) == \
+            bin_particles_3d(particles, nbins=nbins, box_size=box_size)
+    assert bin_sorted_3d(result, 2**level, one_symbol_per_cell=True) == \
+        bin_particles_3d(particles, nbins=2**level, box_size=box_size, one_symbol_per_cell=True)
+    print(f"  {result['inside']} of {len(particles)} particles in the box")
+
+    return result
+
+def test_type_sequence(name, mixed, demixed, box_size):
+    """Test that the type-sequence CID separates a demixed from a random mixture."""
+    print(f"\n{'='*60}")
+    print(f"Testing type sequence: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    from kappa import compute_type_sequence_cid
+    random_mix = compute_type_sequence_cid(mixed, box_size, n_shuffles=3, seed=5)
+    separated = compute_type_sequence_cid(demixed, box_size, n_shuffles=3, seed=5)
+    assert random_mix['length'] == separated['length'] == len(mixed)
+    assert random_mix['n_types'] == 2
+    assert abs(random_mix['cid_normalized'] - 1) < 0.05
+    assert separated['cid_normalized'] < 0.5
+    print(f"  mixed {random_mix['cid_normalized']:.4f}, demixed {separated['cid_normalized']:.4f}")
+
+    return separated
+
+def test_key_gaps(name, lattice, gas, box_size, level):
+    """Test the key-gap stream: it decodes to the sorted keys and separates order."""
+    print(f"\n{'='*60}")
+    print(f"Testing Hilbert key gaps: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    from kappa import compute_key_gap_cid, hilbert_sort_particles
+    gaps, value, shift = [], 0, 0
+    for byte in _native.key_gaps(gas, box_size, level):
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if byte < 0x80:
+            gaps.append(value)
+            value, shift = 0, 0
+    result = hilbert_sort_particles(gas, box_size=box_size, level=level)
+    assert np.array_equal(np.cumsum(gaps), result['keys'][:result['inside']].astype(np.int64))
+
+    ordered = compute_key_gap_cid(lattice, box_size, level, n_shuffles=3, seed=9)
+    disordered = compute_key_gap_cid(gas, box_size, level, n_shuffles=3, seed=9)
+    assert ordered['particles'] == len(lattice)
+    assert ordered['cid_normalized'] < 0.5 < disordered['cid_normalized']
+    print(f"  lattice {ordered['cid_normalized']:.4f}, gas {disordered['cid_normalized']:.4f}")
+
+    return ordered
+
+def test_compositions(name, particles, nbins, box_size, uniform=False):
+    """Test that composition symbols decode to the per-type grids.
+
+    uniform: the particles are placed independently at random, so the CID
+    must match its shuffled baseline, whatever the bytes per cell.
+    """
+    print(f"\n{'='*60}")
+    print(f"Testing composition cells: {name}")
+    print(f"{'='*60}")
+
+    if not _native.available():
+        print("  libkappa not built, skipped")
+        return None
+    from kappa import bin_compositions_3d
+    result = bin_compositions_3d(particles, nbins=nbins, box_size=box_size)
+    symbols = result['symbols']
+    assert len(symbols) == nbins**3
+    assert len(result['buffer']) == nbins**3 * symbols.itemsize
+    assert symbols.itemsize == (1 if len(result['compositions']) <= 256 else 2)
+    assert sorted(set(symbols.tolist())) == list(range(len(result['compositions'])))
+    channels = bin_channels_3d(particles, {t: [t] for t in result['types']}, nbins, box_size)
+    for t, binned in channels.items():
+        decoded = ''.join(chr(ord('0') + result['compositions'][s].get(t, 0)) for s in symbols)
+        assert decoded == binned
+    cid = compute_cid(result['buffer'])
+    print(f"  {len(result['compositions'])} compositions of {len(result['types'])} types, "
+          f"{symbols.itemsize} byte(s) per cell, CID {cid:.4f}")
+    assert result['symbol_bytes'] == symbols.itemsize
+    if uniform:
+        normalized = compute_normalized_cid(result['buffer'], n_shuffles=2, seed=1,
+                                            symbol_bytes=result['symbol_bytes'])
+        print(f"  normalized CID {normalized['cid_normalized']:.4f}")
+        assert abs(normalized['cid_normalized'] - 1) < 0.03
+    if result['symbol_bytes'] == 2:
+        try:
+            compute_null_baselines(result['buffer'], ['density:1'], symbol_bytes=2)
+            assert False, "density null model accepted two-byte cells"
+        except ValueError:
+            pass
+
+    return result
+
 if __name__ == '__main__':
     print("LZ Entropy Calculator Tests")
     print("="*60)
@@ -45,5 +505,87 @@ if __name__ == '__main__':
     # Test 4: More complex pattern
     test_pattern("Complex pattern", b"AABBCCAABBCCAABBCC" * 5)
 
+    # Test 5: Convergence with prefix length
+    test_curve("Random data", os.urandom(2000))
+
+    # Test 6: Longest previous factor
+    test_lpf("Overlapping repeats", b"ABAABAABAABBBAB")
+
+    # Test 7: Overlapping vs non-overlapping parse, exact bit costs
+    test_variants("Periodic crystal-like", b"ABC" * 100)
+
+    # Test 8: Block-shuffle and density-preserving baselines
+    # (8x8x8 grid, one symbol '0' + count per cell, dense half and empty half)
+    test_null_models("Two-phase grid", b"2" * 256 + b"0" * 256)
+
+    # Test 9: Windows over a trajectory whose frames share most of their content
+    frames = [b"0120" * 50 + os.urandom(20) for _ in range(7)]
+    test_windows("Persistent structure", frames, window=3, stride=2)
+
+    # Test 10: Sampled estimate of a long random buffer
+    test_sampled("Random data", (np.random.randint(0, 4, 200000) + ord('0')).astype(np.uint8).tobytes(), 16384)
+    test_sampled_coverage("Homopolymer melt snapshot 1",
+                          load_xyz_snapshot('examples/homopolymer_melt/snapshot_1.xyz'),
+                          [(32, 4096), (64, 4096), (64, 16384)])
+
+    # Test 11: Window-bounded parse of a pattern that repeats at long range
+    block = os.urandom(300)
+    test_bounded_window("Long-range repeats", block + os.urandom(500) + block)
+
+    # Test 12: Running parse of input that arrives in chunks
+    test_online("Growing repeats", b"0" * 50 + b"0110" * 40 + os.urandom(100), chunk=37)
+
+    # Test 13: Guests on the interstitial sites of a host lattice
+    rng = np.random.default_rng(7)
+    host = np.array([[1, x + 0.5, y + 0.5, z + 0.5]
+                     for x in range(0, 16, 2) for y in range(0, 16, 2) for z in range(0, 16, 2)])
+    guest = host[rng.random(len(host)) < 0.3] + [1, 1, 1, 1]
+    test_mutual_information("Host lattice and guests", np.vstack([host, guest]),
+                            {'host': [1], 'guest': [2]}, nbins=16, box_size=16)
+
+    # Test 14: CID of every row of an array, and of buffers of mixed lengths
+    test_batch("Rows of a 2D array",
+               np.random.randint(ord('0'), ord('4'), size=(6, 500)).astype(np.uint8))
+    test_batch("Buffers of mixed lengths", [b"ABC" * 40, os.urandom(300), b"A" * 7])
+
+    # Test 15: Memory budget below the suffix-array workspace
+    test_mem_budget("Random 4-symbol string, 200k symbols",
+                    np.random.randint(ord('0'), ord('4'), size=200000).astype(np.uint8).tobytes())
+
+    # Test 16: Binning and CID through the shared library
+    test_native("Host lattice and guests", np.vstack([host, guest]), nbins=16, box_size=16)
+
+    # Test 17: Snapshots streamed through the native worker pool
+    test_pool("Homopolymer melt snapshots",
+              sorted(glob.glob('examples/homopolymer_melt/snapshot_*.xyz'))[:5])
+
+    # Test 18: Particles sorted along the curve, binned at several grid sizes
+    # (some on the box faces and some outside)
+    cloud = np.column_stack([rng.integers(1, 4, 5000), rng.uniform(-1, 17, (5000, 3))])
+    cloud[:4, 1:4] = [[0, 0, 0], [16, 16, 16], [8, 4, 16], [2.5, 16.0001, 3]]
+    test_hilbert_sort("Random cloud on a 16^3 box", cloud, box_size=16, level=4)
+
+    # Test 19: Grid-free compositional order of a binary mixture
+    positions = rng.uniform(0, 16, (20000, 3))
+    test_type_sequence("Binary mixture, random and split in two halves",
+                       np.column_stack([rng.integers(1, 3, 20000), positions]),
+                       np.column_stack([1 + (positions[:, 0] > 8), positions]), box_size=16)
+
+    # Test 20: Positions as gaps between Hilbert keys, lattice against gas
+    sites = np.arange(16) + 0.5
+    lattice = np.array([[1, x, y, z] for x in sites for y in sites for z in sites])
+    test_key_gaps("Simple cubic lattice and ideal gas", lattice,
+                  np.column_stack([np.ones(len(lattice)), rng.uniform(0, 16, (len(lattice), 3))]),
+                  box_size=16, level=8)
+
+    # Test 21: One composition symbol per cell, with byte and uint16 alphabets
+    test_compositions("Host lattice and guests", np.vstack([host, guest]), nbins=8, box_size=16)
+    test_compositions("Dense six-type mixture",
+                      np.column_stack([rng.integers(1, 7, 40000), rng.uniform(0, 16, (40000, 3))]),
+                      nbins=8, box_size=16)
+    test_compositions("Random six-type gas",
+                      np.column_stack([rng.integers(1, 7, 100000), rng.uniform(0, 16, (100000, 3))]),
+                      nbins=32, box_size=16, uniform=True)
+
     print("\n" + "="*60)
     print("tests done\n")
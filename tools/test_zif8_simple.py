@@ -8,7 +8,8 @@ sys.path.insert(0, 'src')
 
 import numpy as np
 from pathlib import Path
-from kappa import read_lammps_data, filter_by_atom_type, bin_particles_3d, compute_normalized_cid
+from kappa import (read_lammps_data, filter_by_atom_type, bin_particles_3d, bin_channels_3d,
+                   compute_normalized_cid, compute_mutual_information)
 
 def test_zif8(data_file):
     """Test CID computation on ZIF-8 structure."""
@@ -118,6 +119,23 @@ def test_zif8(data_file):
         print(f"  CID (normalized):    {result_ar['cid_normalized']:.4f}")
         print(f"  Compression gain:    {result_ar['compression_gain']:.4f} ({result_ar['compression_gain']*100:.1f}%)")
 
+        # Test 5: How guest placement correlates with the framework
+        print(f"\n{'='*60}")
+        print("Test 5: Framework-guest mutual information")
+        print("="*60)
+
+        channels = bin_channels_3d(coords, {'framework': [1, 2, 3, 4, 5], 'guest': [10]},
+                                   nbins=nbins, box_size=box_size)
+        mi = compute_mutual_information(channels['framework'], channels['guest'])
+
+        print(f"\nCompression-based mutual information:")
+        print(f"  CID (framework):     {mi['cid_a']:.4f}")
+        print(f"  CID (guest):         {mi['cid_b']:.4f}")
+        print(f"  CID (joint):         {mi['cid_joint']:.4f}")
+        print(f"  CID (guest|frame):   {mi['cid_b_given_a']:.4f}")
+        print(f"  MI (joint):          {mi['mi_joint']:.4f}")
+        print(f"  MI (conditional):    {mi['mi_conditional']:.4f}")
+
     # Summary
     print(f"\n{'='*60}")
     print("SUMMARY")